@@ -2,5 +2,7 @@
 
 #include "game_context.h"
 
+const char *GetAbilityUseError(const GameContext *gameContext, const Unit &unitComp, const AbilityDef &abilityDef, const AbilityState &abilityState, const Vector2i &targetCellIdx);
+void SpendAbilityUse(const GameContext *gameContext, Unit &unitComp, const AbilityDef &abilityDef, AbilityState &abilityState);
 void sCycleSelectedAbility(GameContext *gameContext);
 void sUseAbilities(GameContext *gameContext);
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "raylib.h"
+#include <cstdint>
+// Every map cell holds an obstacle entity; the default 32-bit ids run out at about a million entities
+#define ENTT_ID_TYPE std::uint64_t
 #include "entt.hpp"
 #include "vector2_extensions.h"
 
@@ -10,6 +13,8 @@ enum struct Teams
     TEAM_RED,
 };
 
+constexpr int TEAM_COUNT = 2;
+
 enum struct Stances
 {
     STANDING,
@@ -50,18 +55,18 @@ struct Obstacle
     int atlasId;
     Vector2i atlasCoords;
     bool unitStandsOnTop;
+    int templateId = -1;
 };
 
-struct Ability
+// Immutable ability data shared by every unit of a type; see AbilityState for the per-unit part
+struct AbilityDef
 {
     std::string type;
     std::string description;
     bool requiresCell;
     int supplyCost;
     int maxUsesPerTurn;
-    int usesThisTurn = 0;
     int maxCooldown;
-    int lastTurnUsed = -1;
     bool doesBresenhamTargeting;
     bool doesStraightLineTargeting;
     int range;
@@ -83,6 +88,14 @@ struct Ability
     int suppressionRadius;
 };
 
+// Per-unit usage of one AbilityDef. Remaining cooldown is derived from lastTurnUsed and the def's maxCooldown.
+struct AbilityState
+{
+    int abilityDefId;
+    int usesThisTurn = 0;
+    int lastTurnUsed = -1;
+};
+
 struct Unit
 {
     std::string type;
@@ -106,15 +119,16 @@ struct Unit
     bool isStructure;
     int atlasId;
     Vector2i atlasCoords;
-    std::vector<Ability> abilities;
+    std::vector<AbilityState> abilities;
     int selectedAbilityIdx = -1;
-    Ability *selectedAbility = nullptr;
     Teams team;
+    int templateId = -1;
 };
 
 struct MovePoints
 {
     std::vector<Vector2i> moveCellIdxs;
+    int queueOrder = 0; // sMoveUnits carries out lower orders first; see OrderGroupMove
 };
 
 struct TeamBlue
@@ -129,10 +143,6 @@ struct ShouldDestroy
 {
 };
 
-struct IsVisible
-{
-};
-
 struct PopupText
 {
     std::string text;
@@ -157,13 +167,13 @@ struct CellSummary
     bool unitStopsProjectile = false;
     bool obstacleStopsProjectile = false;
 
-    int terrainLevel;
-    int terrainHeight;
-    int unitIntrinsicHeight;
-    int topMostObstacleIntrinsicHeight;
-    int totalHeightIncludingTopMostObstacleExcludingUnit;
-    int totalHeightofUnit;
-    int totalHeightForCellIdx;
+    int terrainLevel = 0;
+    int terrainHeight = 0;
+    int unitIntrinsicHeight = 0;
+    int topMostObstacleIntrinsicHeight = 0;
+    int totalHeightIncludingTopMostObstacleExcludingUnit = 0;
+    int totalHeightofUnit = 0;
+    int totalHeightForCellIdx = 0;
 };
 
 struct PathSummary
@@ -186,8 +196,53 @@ struct IsoscelesTrapezoid
     Vector2 p4;        // top left
 };
 
+// Cells a unit can currently see, as a bitset over the bounding box of its vision trapezoid. Recomputed only when the
+// unit moves or turns, or when a cell height inside the box changes after worldVersion.
+struct Viewshed
+{
+    Vector2i minCellIdx = {0, 0};
+    int width = 0;
+    int height = 0;
+    std::vector<uint64_t> bits;
+
+    bool valid = false; // also means the bits are counted in the team's observer grid
+    uint32_t worldVersion = 0; // MapGrid::worldVersion the bits were computed at
+    Vector2i observerCellIdx = {-1, -1};
+    float facingAngle = 0.0f;
+
+    bool Contains(const Vector2i &cellIdx) const
+    {
+        int localX = cellIdx.x - minCellIdx.x;
+        int localY = cellIdx.y - minCellIdx.y;
+        if (localX < 0 || localY < 0 || localX >= width || localY >= height)
+        {
+            return false;
+        }
+        int bit = localY * width + localX;
+        return (bits[bit >> 6] >> (bit & 63)) & 1;
+    }
+};
+
 struct ScrollPanel
 {
     Rectangle rect;
     std::vector<std::vector<std::string>> items;
+};
+
+// Templates compiled once from the JSON configs; entities are created by copying their prototype
+struct ObstacleTemplate
+{
+    Obstacle prototype;
+    bool incrementTerrainHeight;
+    bool decrementTerrainHeight;
+    bool continueTerrainHeight;
+};
+
+struct UnitTemplate
+{
+    Unit prototype; // abilities already filled in with fresh AbilityStates
+    bool useVision;
+    int visionBaseWidth;
+    int visionTopWidth;
+    int visionLength;
 };
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "game_context.h"
+
+CoverDirections GetCoverDirection(const Vector2i &cellIdx, const Vector2i &fromCellIdx);
+int GetCoverHeightAgainst(const GameContext *gameContext, const Vector2i &cellIdx, const Vector2i &fromCellIdx);
+float GetUnitCoverFraction(const GameContext *gameContext, const Vector2i &cellIdx, const Vector2i &fromCellIdx);
\ No newline at end of file
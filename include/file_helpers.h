@@ -5,6 +5,17 @@
 #include <vector>
 #include "json.hpp"
 
+// Read-only view of a whole file mapped into memory
+struct MappedFile
+{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    void *fileHandle = nullptr;    // Windows only
+    void *mappingHandle = nullptr; // Windows only
+};
+
 std::vector<std::string> GetFileNamesInDirectory(const std::string &directoryPath);
 std::vector<std::string> GetSubdirectoryNamesInDirectory(const std::string &directoryPath);
-nlohmann::json LoadJsonFromFile(const std::string &filePath);
\ No newline at end of file
+nlohmann::json LoadJsonFromFile(const std::string &filePath);
+MappedFile MapFileReadOnly(const std::string &filePath);
+void UnmapFile(MappedFile &mappedFile);
\ No newline at end of file
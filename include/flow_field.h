@@ -0,0 +1,52 @@
+#pragma once
+
+#include "path_search.h"
+
+constexpr uint8_t FLOW_DIRECTION_NONE = 0xFF;
+
+// Integration field toward one goal plus the flow it induces: every cell in the window knows the search cost of its
+// cheapest route to the goal and which neighbour to step to next. Any number of units can follow it, so a group move
+// costs one search instead of one per unit. Like the HPA* abstraction it ignores units; sMoveUnits swaps with them.
+struct FlowField
+{
+    Vector2i goalCellIdx = {-1, -1};
+
+    Vector2i minCellIdx = {0, 0};
+    int windowWidth = 0;
+    int windowHeight = 0;
+    // Final for the source cells of ComputeFlowField and every cell on their routes; the search stops before the rest
+    // of the window is settled
+    std::vector<int64_t> costs;          // search cost to the goal, -1 when the goal cannot be reached from the cell
+    std::vector<uint8_t> nextDirections; // COVER_DIRECTION_OFFSETS index of the next step, FLOW_DIRECTION_NONE at the goal
+
+    // -1 outside the window
+    int GetWindowIdx(const Vector2i &cellIdx) const
+    {
+        int x = cellIdx.x - minCellIdx.x;
+        int y = cellIdx.y - minCellIdx.y;
+        if (x < 0 || y < 0 || x >= windowWidth || y >= windowHeight)
+        {
+            return -1;
+        }
+        return y * windowWidth + x;
+    }
+
+    bool CanReachGoal(const Vector2i &cellIdx) const
+    {
+        int windowIdx = GetWindowIdx(cellIdx);
+        return windowIdx >= 0 && costs[windowIdx] >= 0;
+    }
+
+    // Unchecked; cellIdx must be able to reach the goal
+    int64_t GetCost(const Vector2i &cellIdx) const
+    {
+        return costs[GetWindowIdx(cellIdx)];
+    }
+
+    uint8_t GetNextDirection(const Vector2i &cellIdx) const
+    {
+        return nextDirections[GetWindowIdx(cellIdx)];
+    }
+};
+
+void ComputeFlowField(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &goalCellIdx, const std::vector<Vector2i> &sourceCellIdxs, FlowField &field);
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "components.h"
 #include "json.hpp"
 #include "file_helpers.h"
+#include "map_grid.h"
+#include "flow_field.h"
+#include "path_service.h"
+#include "thread_pool.h"
+#include "template_helpers.h"
 
 struct GameContext
 {
@@ -11,6 +16,7 @@ struct GameContext
     std::string windowTitle = "Open Strategy";
 
     entt::registry registry;
+    ThreadPool threadPool;
 
     int baseFontSize = 16;
     int turnCount = 0;
@@ -22,6 +28,14 @@ struct GameContext
     nlohmann::json obstacleTemplates;
     nlohmann::json unitTemplates;
 
+    // Compiled templates, indexed by template id
+    std::vector<ObstacleTemplate> compiledObstacleTemplates;
+    std::vector<UnitTemplate> compiledUnitTemplates;
+    std::vector<AbilityDef> abilityDefs;
+    std::unordered_map<std::string, int> obstacleTemplateIdByType;
+    std::unordered_map<std::string, int> unitTemplateIdByType;
+    std::unordered_map<uint64_t, int> obstacleTemplateIdByAtlasKey; // MakeAtlasKey(atlasId, atlasCoords) -> template id
+
     int cellWidth;
     int cellHeight;
 
@@ -30,18 +44,28 @@ struct GameContext
 
     int cliffIntrinsicHeight;
 
+    float losCornerSampleInset; // how far the corner LOS samples sit inside the observer's cell, in cells (0, 0.5)
+    float losCoverAccuracyPenalty; // accuracy lost when no LOS sample sees the target, scaled by the hidden fraction
+
+    MoveRules moveRules;
+    PathSearchBuffer pathSearchBuffer; // reused by every path search on the main thread
+    PathHierarchy pathHierarchy;       // brought up to date lazily through pathService
+    FlowField groupFlowField;          // reused by every group move order
+
     std::string currentMap;
     int mapWidth;
     int mapHeight;
 
     std::unordered_map<std::string, Texture2D> allTextures;
-    std::unordered_map<Vector2i, entt::entity> allObstacles;
-    std::unordered_map<Vector2i, entt::entity> allUnits;
-    std::unordered_map<Vector2i, int> terrainLevels;
+    MapGrid mapGrid; // obstacle entity, unit entity and terrain level per cell
+
+    // Background path and reachability searches; hold pathService.LockWorld() while changing cells or units
+    PathService pathService{mapGrid, moveRules, pathHierarchy, threadPool};
 
     Player myPlayer;
 
     entt::entity selectedUnit = entt::null;
+    std::vector<entt::entity> selectedGroup; // shift-clicked units that follow the selected unit's move orders
 
     GameContext()
     {
@@ -64,9 +88,99 @@ struct GameContext
         defaultCellAtlasId = gameSetup["cell_config"]["default_cell_atlas_id"];
         defaultCellAtlasCoords = {gameSetup["cell_config"]["default_cell_atlas_coords"]["x"], gameSetup["cell_config"]["default_cell_atlas_coords"]["y"]};
         cliffIntrinsicHeight = gameSetup["cell_config"]["cliff_intrinsic_height"];
+        losCornerSampleInset = gameSetup["los_config"]["corner_sample_inset"];
+        losCoverAccuracyPenalty = gameSetup["los_config"]["cover_accuracy_penalty"];
+        moveRules.maxClimbLevels = gameSetup["move_config"]["max_climb_levels"];
+        moveRules.climbCostSupplies = gameSetup["move_config"]["climb_cost_supplies"];
 
         obstacleTemplates = LoadJsonFromFile("config/obstacle_templates.json");
         unitTemplates = LoadJsonFromFile("config/unit_templates.json");
+
+        CompileTemplates();
+    }
+
+    static uint64_t MakeAtlasKey(const int &atlasId, const int &atlasX, const int &atlasY)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(atlasId)) << 32) | (static_cast<uint64_t>(static_cast<uint16_t>(atlasX)) << 16) | static_cast<uint16_t>(atlasY);
+    }
+
+    // Rebuild after adding or replacing templates (e.g. from mods)
+    void CompileTemplates()
+    {
+        compiledObstacleTemplates.clear();
+        compiledUnitTemplates.clear();
+        abilityDefs.clear();
+        obstacleTemplateIdByType.clear();
+        unitTemplateIdByType.clear();
+        obstacleTemplateIdByAtlasKey.clear();
+        obstacleTemplateIdByAtlasKey.reserve(obstacleTemplates.size());
+
+        for (const auto &templateData : obstacleTemplates.items())
+        {
+            int templateId = static_cast<int>(compiledObstacleTemplates.size());
+            compiledObstacleTemplates.push_back(CompileObstacleTemplate(templateData.key(), templateData.value()));
+            compiledObstacleTemplates.back().prototype.templateId = templateId;
+            obstacleTemplateIdByType[templateData.key()] = templateId;
+
+            const Obstacle &prototype = compiledObstacleTemplates.back().prototype;
+            uint64_t atlasKey = MakeAtlasKey(prototype.atlasId, prototype.atlasCoords.x, prototype.atlasCoords.y);
+            // The first template wins on duplicate atlas coords, same as the old linear scan
+            if (!obstacleTemplateIdByAtlasKey.emplace(atlasKey, templateId).second)
+            {
+                std::cerr << "Obstacle template " << templateData.key() << " shares atlas coords with " << compiledObstacleTemplates[obstacleTemplateIdByAtlasKey[atlasKey]].prototype.type << ", ignoring it for atlas lookups" << std::endl;
+            }
+        }
+
+        for (const auto &templateData : unitTemplates.items())
+        {
+            int templateId = static_cast<int>(compiledUnitTemplates.size());
+            compiledUnitTemplates.push_back(CompileUnitTemplate(templateData.key(), templateData.value(), abilityDefs));
+            compiledUnitTemplates.back().prototype.templateId = templateId;
+            unitTemplateIdByType[templateData.key()] = templateId;
+        }
+
+        // Cells without an obstacle cost as much as the cheapest one, which keeps the A* heuristic a lower bound
+        moveRules.minMoveCostSupplies = 0;
+        for (size_t templateId = 0; templateId < compiledObstacleTemplates.size(); templateId++)
+        {
+            int moveCost = std::clamp(compiledObstacleTemplates[templateId].prototype.moveCostSupplies, 0, 255);
+            moveRules.minMoveCostSupplies = templateId == 0 ? moveCost : std::min(moveRules.minMoveCostSupplies, moveCost);
+        }
+    }
+
+    const AbilityDef &GetAbilityDef(const AbilityState &abilityState) const
+    {
+        return abilityDefs[abilityState.abilityDefId];
+    }
+
+    // Returns nullptr when the unit has no ability selected
+    const AbilityDef *GetSelectedAbilityDef(const Unit &unitComp) const
+    {
+        if (unitComp.selectedAbilityIdx < 0 || unitComp.selectedAbilityIdx >= static_cast<int>(unitComp.abilities.size()))
+        {
+            return nullptr;
+        }
+        return &abilityDefs[unitComp.abilities[unitComp.selectedAbilityIdx].abilityDefId];
+    }
+
+    // Returns -1 if there is no template of this type
+    int GetObstacleTemplateId(const std::string &type) const
+    {
+        auto it = obstacleTemplateIdByType.find(type);
+        return it != obstacleTemplateIdByType.end() ? it->second : -1;
+    }
+
+    int GetUnitTemplateId(const std::string &type) const
+    {
+        auto it = unitTemplateIdByType.find(type);
+        return it != unitTemplateIdByType.end() ? it->second : -1;
+    }
+
+    // Returns -1 if no template uses these atlas coords
+    int GetObstacleTemplateIdByAtlasCoords(const int &atlasId, const Vector2i &atlasCoords) const
+    {
+        auto it = obstacleTemplateIdByAtlasKey.find(MakeAtlasKey(atlasId, atlasCoords.x, atlasCoords.y));
+        return it != obstacleTemplateIdByAtlasKey.end() ? it->second : -1;
     }
 
     void LoadAllTextures()
@@ -109,14 +223,12 @@ struct GameContext
 
     nlohmann::json GetObstacleTemplateByAtlasCoords(const int &atlasId, const Vector2 &atlasCoords)
     {
-        for (const auto &templateData : obstacleTemplates.items())
+        int templateId = GetObstacleTemplateIdByAtlasCoords(atlasId, {static_cast<int>(atlasCoords.x), static_cast<int>(atlasCoords.y)});
+        if (templateId < 0)
         {
-            if (templateData.value()["atlas_id"] == atlasId && (templateData.value()["atlas_coords"]["x"] == atlasCoords.x && templateData.value()["atlas_coords"]["y"] == atlasCoords.y))
-            {
-                return templateData.value();
-            }
+            return nlohmann::json(); // Return an empty json object if no match is found
         }
-        return nlohmann::json(); // Return an empty json object if no match is found
+        return obstacleTemplates[compiledObstacleTemplates[templateId].prototype.type];
     }
 
     Rectangle GetCameraViewportWorldRect()
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "game_context.h"
+#include "los_kernel.h"
+
+struct LOSResult
+{
+    bool hasLOS = true;
+    Vector2i blockingCell = {-1, -1}; // first occluding cell, {-1, -1} when there is LOS
+    float clearance = 0.0f;            // smallest height of the ray above an intermediate cell; negative when blocked
+};
+
+// Multi-sample LOS casts from the center and the four corners of the observer's cell (pulled in by
+// GameContext::losCornerSampleInset) to the target's center, so a unit peeking past an edge still gets a line
+constexpr int LOS_SAMPLE_COUNT = 5;
+
+struct MultiSampleLOSResult
+{
+    int visibleSampleCount = 0;
+    Vector2i blockingCell = {-1, -1}; // where the center ray is blocked, {-1, -1} when it is clear
+
+    bool IsAnyVisible() const
+    {
+        return visibleSampleCount > 0;
+    }
+
+    float GetVisibleFraction() const
+    {
+        return static_cast<float>(visibleSampleCount) / LOS_SAMPLE_COUNT;
+    }
+};
+
+LOSResult TraceElevationRay(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2 &startWorldPos, const float &startHeight, const Vector2i &targetCellIdx, const Vector2 &endWorldPos, const float &endHeight);
+LOSResult TraceElevationLOS(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx);
+// With stopAtFirstVisible the samples are traced one by one until one sees the target, so only IsAnyVisible is
+// meaningful; otherwise all samples go through the batched path together
+MultiSampleLOSResult TraceMultiSampleLOS(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const bool &stopAtFirstVisible);
+// Fraction of multi-sample rays (0 to 1) that see each query's target
+void GetVisibleFractionBatch(const GameContext *gameContext, const LOSQuery *queries, const int &count, float *outVisibleFractions);
\ No newline at end of file
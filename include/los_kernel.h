@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Plain data interface of the batched LOS kernel. The AVX2 translation unit is compiled with its own instruction set
+// flags, so it must only see these types and never the game headers.
+struct LOSKernelGrid
+{
+    const int *totalHeights; // MapGrid::totalHeights, chunk-major
+    int width;
+    int height;
+    int chunksX;
+    int cellWidth;
+    int cellHeight;
+};
+
+struct LOSQuery
+{
+    int observerX;
+    int observerY;
+    int targetX;
+    int targetY;
+};
+
+// A ray that starts anywhere inside the observer's cell (world units) and ends at the target cell's center
+struct LOSRay
+{
+    int observerX;
+    int observerY;
+    int targetX;
+    int targetY;
+    float startWorldX;
+    float startWorldY;
+};
+
+void HasElevationRayBatchAVX2(const LOSKernelGrid &grid, const LOSRay *rays, const int &count, uint8_t *outHasLOS);
\ No newline at end of file
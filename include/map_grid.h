@@ -0,0 +1,401 @@
+#pragma once
+
+#include "components.h"
+#include <algorithm>
+#include <vector>
+
+enum CellFlags : uint8_t
+{
+    CELL_FLAG_NONE = 0,
+    CELL_FLAG_UNIT_STOPS_PROJECTILE = 1 << 0,
+    CELL_FLAG_OBSTACLE_STOPS_PROJECTILE = 1 << 1,
+    CELL_FLAG_CLIFF = 1 << 2,
+};
+
+// Sides of a cell, clockwise from north (-y). Indexes the directional cover layer
+enum CoverDirections : uint8_t
+{
+    COVER_NORTH,
+    COVER_NORTH_EAST,
+    COVER_EAST,
+    COVER_SOUTH_EAST,
+    COVER_SOUTH,
+    COVER_SOUTH_WEST,
+    COVER_WEST,
+    COVER_NORTH_WEST,
+    COVER_DIRECTION_COUNT,
+};
+
+constexpr int COVER_DIRECTION_OFFSETS_X[COVER_DIRECTION_COUNT] = {0, 1, 1, 1, 0, -1, -1, -1};
+constexpr int COVER_DIRECTION_OFFSETS_Y[COVER_DIRECTION_COUNT] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+// Dense per-cell map storage. Cells are grouped into CHUNK_SIZE x CHUNK_SIZE chunks and every layer is a flat
+// struct-of-arrays vector indexed chunk-major, so neighbouring cells share cache lines and a chunk can be walked
+// as one contiguous block.
+struct MapGrid
+{
+    static constexpr int CHUNK_SHIFT = 5;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT; // 32x32 cells per chunk
+    static constexpr int CHUNK_MASK = CHUNK_SIZE - 1;
+    static constexpr int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+
+    int width = 0;
+    int height = 0;
+    int chunksX = 0;
+    int chunksY = 0;
+
+    std::vector<entt::entity> obstacles;
+    std::vector<entt::entity> units;
+    std::vector<int> terrainLevels;
+
+    // Materialized CellSummary heights, kept up to date by RefreshCellSummary whenever a cell's contents change
+    std::vector<int> terrainHeights;
+    std::vector<int> unitIntrinsicHeights;
+    std::vector<int> obstacleIntrinsicHeights;
+    std::vector<int> obstacleTopHeights; // total height including top-most obstacle, excluding unit
+    std::vector<int> unitTopHeights;     // total height of unit
+    std::vector<int> totalHeights;
+    std::vector<uint8_t> cellFlags;
+    std::vector<uint8_t> moveCosts; // supplies it costs to step into the cell, clamped to 255
+
+    // Max-height pyramid over totalHeights: maxHeightLevels[i] holds, row-major, the highest total height in each
+    // block of 2^(i + 1) x 2^(i + 1) cells, up to one block per chunk. Lets ray queries skip whole blocks at once.
+    static constexpr int MAX_HEIGHT_LEVEL_COUNT = CHUNK_SHIFT;
+    std::vector<int> maxHeightLevels[MAX_HEIGHT_LEVEL_COUNT];
+
+    // Directional cover, COVER_DIRECTION_COUNT entries per cell at CellToIndex(cellIdx) * COVER_DIRECTION_COUNT: how far
+    // the terrain and obstacles on each side rise above the cell's ground, clamped to 255. Units never count as cover.
+    std::vector<uint8_t> coverHeights;
+
+    // Fog of war: number of a team's viewsheds that contain each cell, indexed by Teams
+    std::vector<uint16_t> teamObserverCounts[TEAM_COUNT];
+
+    // Change tracking for cached queries: worldVersion is bumped whenever a cell's total height changes and the
+    // cell's chunk is stamped with the new version
+    uint32_t worldVersion = 0;
+    std::vector<uint32_t> chunkVersions;
+
+    // The same for movement: navVersion is bumped whenever a cell's move cost or cliff flag changes, stamping
+    // chunkNavVersions, and occupancyVersion whenever a unit enters or leaves a cell
+    uint32_t navVersion = 0;
+    std::vector<uint32_t> chunkNavVersions;
+    uint32_t occupancyVersion = 0;
+
+    void Resize(const int &mapWidth, const int &mapHeight)
+    {
+        width = mapWidth;
+        height = mapHeight;
+        chunksX = (mapWidth + CHUNK_MASK) >> CHUNK_SHIFT;
+        chunksY = (mapHeight + CHUNK_MASK) >> CHUNK_SHIFT;
+
+        size_t cellCount = static_cast<size_t>(chunksX) * chunksY * CHUNK_AREA;
+        obstacles.assign(cellCount, entt::null);
+        units.assign(cellCount, entt::null);
+        terrainLevels.assign(cellCount, 0);
+        terrainHeights.assign(cellCount, 0);
+        unitIntrinsicHeights.assign(cellCount, 0);
+        obstacleIntrinsicHeights.assign(cellCount, 0);
+        obstacleTopHeights.assign(cellCount, 0);
+        unitTopHeights.assign(cellCount, 0);
+        totalHeights.assign(cellCount, 0);
+        cellFlags.assign(cellCount, CELL_FLAG_NONE);
+        moveCosts.assign(cellCount, 0);
+        coverHeights.assign(cellCount * COVER_DIRECTION_COUNT, 0);
+        for (std::vector<uint16_t> &observerCounts : teamObserverCounts)
+        {
+            observerCounts.assign(cellCount, 0);
+        }
+        chunkVersions.assign(static_cast<size_t>(chunksX) * chunksY, 0);
+        chunkNavVersions.assign(static_cast<size_t>(chunksX) * chunksY, 0);
+        MarkAllChanged();
+        for (int level = 1; level <= MAX_HEIGHT_LEVEL_COUNT; level++)
+        {
+            maxHeightLevels[level - 1].assign(static_cast<size_t>(GetLevelWidth(level)) * GetLevelHeight(level), 0);
+        }
+    }
+
+    int GetLevelWidth(const int &level) const
+    {
+        return (width + (1 << level) - 1) >> level;
+    }
+
+    int GetLevelHeight(const int &level) const
+    {
+        return (height + (1 << level) - 1) >> level;
+    }
+
+    // Highest total height in block (blockX, blockY) of the given level; level 0 is a single cell. Unchecked
+    int GetMaxHeight(const int &level, const int &blockX, const int &blockY) const
+    {
+        if (level == 0)
+        {
+            return totalHeights[CellToIndex({blockX, blockY})];
+        }
+        return maxHeightLevels[level - 1][blockY * GetLevelWidth(level) + blockX];
+    }
+
+    // Recomputes one pyramid block from its (up to four) children
+    int ComputeMaxHeightBlock(const int &level, const int &blockX, const int &blockY) const
+    {
+        int childMaxX = std::min(blockX * 2 + 1, GetLevelWidth(level - 1) - 1);
+        int childMaxY = std::min(blockY * 2 + 1, GetLevelHeight(level - 1) - 1);
+        int maxHeight = GetMaxHeight(level - 1, blockX * 2, blockY * 2);
+        for (int childY = blockY * 2; childY <= childMaxY; childY++)
+        {
+            for (int childX = blockX * 2; childX <= childMaxX; childX++)
+            {
+                maxHeight = std::max(maxHeight, GetMaxHeight(level - 1, childX, childY));
+            }
+        }
+        return maxHeight;
+    }
+
+    // Call after a cell's total height changed; walks up the pyramid until a block's max stays the same
+    void UpdateMaxHeightPyramid(const Vector2i &cellIdx)
+    {
+        for (int level = 1; level <= MAX_HEIGHT_LEVEL_COUNT; level++)
+        {
+            int blockX = cellIdx.x >> level;
+            int blockY = cellIdx.y >> level;
+            int maxHeight = ComputeMaxHeightBlock(level, blockX, blockY);
+            int &storedMaxHeight = maxHeightLevels[level - 1][blockY * GetLevelWidth(level) + blockX];
+            if (storedMaxHeight == maxHeight)
+            {
+                return;
+            }
+            storedMaxHeight = maxHeight;
+        }
+    }
+
+    void RebuildMaxHeightPyramid()
+    {
+        for (int level = 1; level <= MAX_HEIGHT_LEVEL_COUNT; level++)
+        {
+            int levelWidth = GetLevelWidth(level);
+            for (int blockY = 0; blockY < GetLevelHeight(level); blockY++)
+            {
+                for (int blockX = 0; blockX < levelWidth; blockX++)
+                {
+                    maxHeightLevels[level - 1][blockY * levelWidth + blockX] = ComputeMaxHeightBlock(level, blockX, blockY);
+                }
+            }
+        }
+    }
+
+    // What a cell offers as cover to its neighbours: its terrain, or the top of its obstacle
+    int GetCoverSourceHeight(const int &idx) const
+    {
+        return std::max(terrainHeights[idx], obstacleTopHeights[idx]);
+    }
+
+    // Recomputes the cover entries of one in-bounds cell from its neighbours' current heights
+    void UpdateCover(const Vector2i &cellIdx)
+    {
+        int idx = CellToIndex(cellIdx);
+        int groundHeight = terrainHeights[idx];
+        int sideHeights[COVER_DIRECTION_COUNT];
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            Vector2i neighborCellIdx = {cellIdx.x + COVER_DIRECTION_OFFSETS_X[direction], cellIdx.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+            sideHeights[direction] = InBounds(neighborCellIdx) ? GetCoverSourceHeight(CellToIndex(neighborCellIdx)) - groundHeight : 0;
+        }
+
+        uint8_t *cellCover = &coverHeights[static_cast<size_t>(idx) * COVER_DIRECTION_COUNT];
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            int cover = sideHeights[direction];
+            if (direction % 2 == 1)
+            {
+                // Fire from a corner also has to pass both orthogonal neighbours
+                cover = std::max(cover, std::min(sideHeights[direction - 1], sideHeights[(direction + 1) % COVER_DIRECTION_COUNT]));
+            }
+            cellCover[direction] = static_cast<uint8_t>(std::clamp(cover, 0, 255));
+        }
+    }
+
+    // Call after a cell's cover source height changed; its own ground and all of its neighbours' cover depend on it
+    void UpdateCoverAround(const Vector2i &cellIdx)
+    {
+        for (int y = std::max(cellIdx.y - 1, 0); y <= std::min(cellIdx.y + 1, height - 1); y++)
+        {
+            for (int x = std::max(cellIdx.x - 1, 0); x <= std::min(cellIdx.x + 1, width - 1); x++)
+            {
+                UpdateCover({x, y});
+            }
+        }
+    }
+
+    // Unchecked
+    int GetCover(const Vector2i &cellIdx, const CoverDirections &direction) const
+    {
+        return coverHeights[static_cast<size_t>(CellToIndex(cellIdx)) * COVER_DIRECTION_COUNT + direction];
+    }
+
+    void MarkCellChanged(const Vector2i &cellIdx)
+    {
+        worldVersion++;
+        chunkVersions[(cellIdx.y >> CHUNK_SHIFT) * chunksX + (cellIdx.x >> CHUNK_SHIFT)] = worldVersion;
+    }
+
+    void MarkNavChanged(const Vector2i &cellIdx)
+    {
+        navVersion++;
+        chunkNavVersions[(cellIdx.y >> CHUNK_SHIFT) * chunksX + (cellIdx.x >> CHUNK_SHIFT)] = navVersion;
+    }
+
+    void MarkAllChanged()
+    {
+        worldVersion++;
+        std::fill(chunkVersions.begin(), chunkVersions.end(), worldVersion);
+        navVersion++;
+        std::fill(chunkNavVersions.begin(), chunkNavVersions.end(), navVersion);
+        occupancyVersion++;
+    }
+
+    // True when any cell inside [minCellIdx, maxCellIdx] (inclusive) may have changed after sinceVersion
+    bool HasChangedInRect(const Vector2i &minCellIdx, const Vector2i &maxCellIdx, const uint32_t &sinceVersion) const
+    {
+        int minChunkX = std::max(minCellIdx.x, 0) >> CHUNK_SHIFT;
+        int minChunkY = std::max(minCellIdx.y, 0) >> CHUNK_SHIFT;
+        int maxChunkX = std::min(maxCellIdx.x, width - 1) >> CHUNK_SHIFT;
+        int maxChunkY = std::min(maxCellIdx.y, height - 1) >> CHUNK_SHIFT;
+        for (int chunkY = minChunkY; chunkY <= maxChunkY; chunkY++)
+        {
+            for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX++)
+            {
+                if (chunkVersions[chunkY * chunksX + chunkX] > sinceVersion)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool InBounds(const Vector2i &cellIdx) const
+    {
+        return cellIdx.x >= 0 && cellIdx.y >= 0 && cellIdx.x < width && cellIdx.y < height;
+    }
+
+    // Unchecked; callers must make sure cellIdx is in bounds
+    int CellToIndex(const Vector2i &cellIdx) const
+    {
+        int chunkIdx = (cellIdx.y >> CHUNK_SHIFT) * chunksX + (cellIdx.x >> CHUNK_SHIFT);
+        int localIdx = ((cellIdx.y & CHUNK_MASK) << CHUNK_SHIFT) | (cellIdx.x & CHUNK_MASK);
+        return (chunkIdx << (CHUNK_SHIFT * 2)) | localIdx;
+    }
+
+    Vector2i IndexToCell(const int &idx) const
+    {
+        int chunkIdx = idx >> (CHUNK_SHIFT * 2);
+        int localIdx = idx & (CHUNK_AREA - 1);
+        return {((chunkIdx % chunksX) << CHUNK_SHIFT) | (localIdx & CHUNK_MASK),
+                ((chunkIdx / chunksX) << CHUNK_SHIFT) | (localIdx >> CHUNK_SHIFT)};
+    }
+
+    entt::entity GetObstacle(const Vector2i &cellIdx) const
+    {
+        return InBounds(cellIdx) ? obstacles[CellToIndex(cellIdx)] : entt::null;
+    }
+
+    entt::entity GetUnit(const Vector2i &cellIdx) const
+    {
+        return InBounds(cellIdx) ? units[CellToIndex(cellIdx)] : entt::null;
+    }
+
+    int GetTerrainLevel(const Vector2i &cellIdx) const
+    {
+        return InBounds(cellIdx) ? terrainLevels[CellToIndex(cellIdx)] : 0;
+    }
+
+    bool HasObstacle(const Vector2i &cellIdx) const
+    {
+        return GetObstacle(cellIdx) != entt::null;
+    }
+
+    bool HasUnit(const Vector2i &cellIdx) const
+    {
+        return GetUnit(cellIdx) != entt::null;
+    }
+
+    // Setters ignore out of bounds cells, matching how the old hash maps silently accepted any key
+    void SetObstacle(const Vector2i &cellIdx, const entt::entity &entity)
+    {
+        if (InBounds(cellIdx))
+        {
+            obstacles[CellToIndex(cellIdx)] = entity;
+        }
+    }
+
+    void SetUnit(const Vector2i &cellIdx, const entt::entity &entity)
+    {
+        if (InBounds(cellIdx))
+        {
+            units[CellToIndex(cellIdx)] = entity;
+            occupancyVersion++;
+        }
+    }
+
+    void SetTerrainLevel(const Vector2i &cellIdx, const int &terrainLevel)
+    {
+        if (InBounds(cellIdx))
+        {
+            terrainLevels[CellToIndex(cellIdx)] = terrainLevel;
+        }
+    }
+
+    // Visits every in-bounds cell of one chunk in memory order: func(cellIdx, idx)
+    template <typename Func>
+    void ForEachCellInChunk(const int &chunkX, const int &chunkY, Func &&func) const
+    {
+        int startX = chunkX << CHUNK_SHIFT;
+        int startY = chunkY << CHUNK_SHIFT;
+        int endX = std::min(startX + CHUNK_SIZE, width);
+        int endY = std::min(startY + CHUNK_SIZE, height);
+        int chunkBase = (chunkY * chunksX + chunkX) << (CHUNK_SHIFT * 2);
+
+        for (int y = startY; y < endY; y++)
+        {
+            int rowBase = chunkBase | ((y & CHUNK_MASK) << CHUNK_SHIFT);
+            for (int x = startX; x < endX; x++)
+            {
+                func(Vector2i{x, y}, rowBase | (x & CHUNK_MASK));
+            }
+        }
+    }
+
+    // Visits every in-bounds cell inside [minCellIdx, maxCellIdx] (inclusive), chunk by chunk: func(cellIdx, idx)
+    template <typename Func>
+    void ForEachCellInRect(const Vector2i &minCellIdx, const Vector2i &maxCellIdx, Func &&func) const
+    {
+        int minX = std::max(minCellIdx.x, 0);
+        int minY = std::max(minCellIdx.y, 0);
+        int maxX = std::min(maxCellIdx.x, width - 1);
+        int maxY = std::min(maxCellIdx.y, height - 1);
+        if (minX > maxX || minY > maxY)
+        {
+            return;
+        }
+
+        for (int chunkY = minY >> CHUNK_SHIFT; chunkY <= maxY >> CHUNK_SHIFT; chunkY++)
+        {
+            for (int chunkX = minX >> CHUNK_SHIFT; chunkX <= maxX >> CHUNK_SHIFT; chunkX++)
+            {
+                int startX = std::max(chunkX << CHUNK_SHIFT, minX);
+                int startY = std::max(chunkY << CHUNK_SHIFT, minY);
+                int endX = std::min((chunkX << CHUNK_SHIFT) + CHUNK_MASK, maxX);
+                int endY = std::min((chunkY << CHUNK_SHIFT) + CHUNK_MASK, maxY);
+                int chunkBase = (chunkY * chunksX + chunkX) << (CHUNK_SHIFT * 2);
+
+                for (int y = startY; y <= endY; y++)
+                {
+                    int rowBase = chunkBase | ((y & CHUNK_MASK) << CHUNK_SHIFT);
+                    for (int x = startX; x <= endX; x++)
+                    {
+                        func(Vector2i{x, y}, rowBase | (x & CHUNK_MASK));
+                    }
+                }
+            }
+        }
+    }
+};
\ No newline at end of file
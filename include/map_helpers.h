@@ -3,8 +3,16 @@
 #include "game_context.h"
 
 void BuildMap(GameContext *gameContext, const std::string &mapName);
+void BuildMapFromJson(GameContext *gameContext, const std::string &mapName);
+void BuildMapFromTemplateIds(GameContext *gameContext, const std::vector<int> &templateIds);
+void ComputeTerrainLevels(GameContext *gameContext, const std::vector<int> &templateIds);
 void Startup(GameContext *gameContext);
 bool CheckMouseInMapBounds(GameContext *gameContext);
+bool CheckCellInMapBounds(const GameContext *gameContext, const Vector2i &cellIdx);
+
+int GetUnitStanceHeight(const Unit &unitComp);
+void RefreshCellSummary(GameContext *gameContext, const Vector2i &cellIdx);
+void RefreshCellSummariesInRect(GameContext *gameContext, const Vector2i &minCellIdx, const Vector2i &maxCellIdx);
 
 int GetTerrainLevelForCellIdx(GameContext *gameContext, const Vector2i &cellIdx);
 int GetTerrainHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx);
@@ -14,4 +22,40 @@ int GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(GameContext *g
 int GetTotalHeightOfUnitForCellIdx(GameContext *gameContext, const Vector2i &cellIdx);
 int GetTotalHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx);
 CellSummary GetCellSummary(GameContext *gameContext, const Vector2i &cellIdx);
-Vector2i HasElevationLOS(GameContext *gameContext, const float &perCellWidthFeet, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const Vector2i &betweenCellIdx);
+CellSummary GetCellSummaryUnchecked(const GameContext *gameContext, const Vector2i &cellIdx);
+
+// Unchecked fast path for callers that already clipped their range to the map bounds
+inline int GetTerrainLevelForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.terrainLevels[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetTerrainHeightForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.terrainHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetUnitIntrinsicHeightForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.unitIntrinsicHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetTopMostObstacleIntrinsicHeightForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.obstacleIntrinsicHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.obstacleTopHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetTotalHeightOfUnitForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.unitTopHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
+
+inline int GetTotalHeightForCellIdxUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return gameContext->mapGrid.totalHeights[gameContext->mapGrid.CellToIndex(cellIdx)];
+}
\ No newline at end of file
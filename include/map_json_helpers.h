@@ -0,0 +1,25 @@
+#pragma once
+
+#include "components.h"
+#include <string>
+#include <vector>
+
+// One non-empty cell of a JSON map, decoded straight from the token stream
+struct MapCellRecord
+{
+    uint16_t cellX;
+    uint16_t cellY;
+    uint16_t atlasId;
+    uint16_t atlasX;
+    uint16_t atlasY;
+};
+
+struct JsonMapCells
+{
+    int mapWidth = 0;
+    int mapHeight = 0;
+    std::vector<MapCellRecord> cells;
+};
+
+bool ParseVector2iString(const std::string &vector2String, Vector2i &result);
+JsonMapCells LoadJsonMapCells(const std::string &filePath);
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "game_context.h"
+#include <cmath>
+#include <limits>
 #include <random>
 
 Vector2i Vector2ToVector2i(const Vector2 &vector2);
@@ -36,4 +38,121 @@ T GetRandomItemFromVector(const std::vector<T> &vec)
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> distrib(0, vec.size() - 1);
     return vec[distrib(gen)];
+}
+
+// Amanatides-Woo traversal of every cell a world-space segment crosses, in order from start to end, without
+// allocating. Calls visitor(cellIdx, tEnter, tExit), with t in [0, 1] along the segment; return false to stop early.
+// When the segment passes exactly through a cell corner, supercover also visits the two cells sharing that corner.
+template <typename Visitor>
+void TraverseGridLine(const Vector2 &startWorldPos, const Vector2 &endWorldPos, const int &cellWidth, const int &cellHeight, const bool &supercover, Visitor &&visitor)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    float startX = startWorldPos.x / cellWidth;
+    float startY = startWorldPos.y / cellHeight;
+    float deltaX = endWorldPos.x / cellWidth - startX;
+    float deltaY = endWorldPos.y / cellHeight - startY;
+
+    Vector2i cell = {static_cast<int>(std::floor(startX)), static_cast<int>(std::floor(startY))};
+    Vector2i endCell = WorldToMap(endWorldPos, cellWidth, cellHeight);
+    int stepX = deltaX > 0 ? 1 : (deltaX < 0 ? -1 : 0);
+    int stepY = deltaY > 0 ? 1 : (deltaY < 0 ? -1 : 0);
+
+    // t at which the segment crosses the next vertical / horizontal grid line, and t per whole cell
+    float tDeltaX = stepX != 0 ? 1.0f / std::fabs(deltaX) : infinity;
+    float tDeltaY = stepY != 0 ? 1.0f / std::fabs(deltaY) : infinity;
+    float tMaxX = stepX > 0 ? (cell.x + 1 - startX) * tDeltaX : (stepX < 0 ? (startX - cell.x) * tDeltaX : infinity);
+    float tMaxY = stepY > 0 ? (cell.y + 1 - startY) * tDeltaY : (stepY < 0 ? (startY - cell.y) * tDeltaY : infinity);
+
+    // Bounds the walk in case rounding ever steps past the end cell
+    int remainingSteps = std::abs(endCell.x - cell.x) + std::abs(endCell.y - cell.y);
+    float tEnter = 0.0f;
+    for (;;)
+    {
+        float tExit = std::min(std::min(tMaxX, tMaxY), 1.0f);
+        if (!visitor(cell, tEnter, tExit) || (cell.x == endCell.x && cell.y == endCell.y) || remainingSteps-- <= 0)
+        {
+            return;
+        }
+
+        if (tMaxX < tMaxY)
+        {
+            cell.x += stepX;
+            tEnter = tMaxX;
+            tMaxX += tDeltaX;
+        }
+        else if (tMaxY < tMaxX)
+        {
+            cell.y += stepY;
+            tEnter = tMaxY;
+            tMaxY += tDeltaY;
+        }
+        else
+        {
+            // Exactly through a corner: step diagonally
+            if (supercover)
+            {
+                if (!visitor(Vector2i{cell.x + stepX, cell.y}, tMaxX, tMaxX) || !visitor(Vector2i{cell.x, cell.y + stepY}, tMaxX, tMaxX))
+                {
+                    return;
+                }
+            }
+            cell.x += stepX;
+            cell.y += stepY;
+            tEnter = tMaxX;
+            tMaxX += tDeltaX;
+            tMaxY += tDeltaY;
+            remainingSteps--;
+        }
+    }
+}
+
+// Scanline fill of a convex world-space polygon: for every grid row the polygon touches, calls
+// visitor(row, minCol, maxCol) with the inclusive range of cells whose rectangles overlap it. Touching edges count as
+// overlap, like CheckCollisionTrapezoidRectangle.
+template <typename Visitor>
+void RasterizeConvexPolygon(const Vector2 *vertices, const int &vertexCount, const int &cellWidth, const int &cellHeight, Visitor &&visitor)
+{
+    float minY = vertices[0].y;
+    float maxY = vertices[0].y;
+    for (int i = 1; i < vertexCount; i++)
+    {
+        minY = std::min(minY, vertices[i].y);
+        maxY = std::max(maxY, vertices[i].y);
+    }
+
+    int minRow = static_cast<int>(std::ceil(minY / cellHeight)) - 1;
+    int maxRow = static_cast<int>(std::floor(maxY / cellHeight));
+    for (int row = minRow; row <= maxRow; row++)
+    {
+        // x extent of the polygon clipped to the row's band: vertices inside the band plus edge crossings of its borders
+        float bandTop = static_cast<float>(row * cellHeight);
+        float bandBottom = static_cast<float>((row + 1) * cellHeight);
+        float spanMin = std::numeric_limits<float>::infinity();
+        float spanMax = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < vertexCount; i++)
+        {
+            const Vector2 &a = vertices[i];
+            const Vector2 &b = vertices[(i + 1) % vertexCount];
+            if (a.y >= bandTop && a.y <= bandBottom)
+            {
+                spanMin = std::min(spanMin, a.x);
+                spanMax = std::max(spanMax, a.x);
+            }
+            for (float borderY : {bandTop, bandBottom})
+            {
+                if ((a.y < borderY && b.y > borderY) || (a.y > borderY && b.y < borderY))
+                {
+                    float x = a.x + (b.x - a.x) * ((borderY - a.y) / (b.y - a.y));
+                    spanMin = std::min(spanMin, x);
+                    spanMax = std::max(spanMax, x);
+                }
+            }
+        }
+        if (spanMin > spanMax)
+        {
+            continue;
+        }
+
+        visitor(row, static_cast<int>(std::ceil(spanMin / cellWidth)) - 1, static_cast<int>(std::floor(spanMax / cellWidth)));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "game_context.h"
+
+// Compiled binary map format (.osmap), all integers little-endian:
+//   OSMAP_HEADER_SIZE byte header: magic "OSMP", version, map width, map height, cell data offset, reserved
+//   mapWidth * mapHeight packed cells in row-major order, OSMAP_CELL_SIZE bytes each:
+//     uint16 atlas id (OSMAP_EMPTY_ATLAS_ID for cells without an obstacle), uint8 atlas x, uint8 atlas y
+constexpr char OSMAP_MAGIC[4] = {'O', 'S', 'M', 'P'};
+constexpr uint32_t OSMAP_VERSION = 1;
+constexpr size_t OSMAP_HEADER_SIZE = 24;
+constexpr size_t OSMAP_CELL_SIZE = 4;
+constexpr uint16_t OSMAP_EMPTY_ATLAS_ID = 0xFFFF;
+
+struct OsmapHeader
+{
+    uint32_t version;
+    uint32_t mapWidth;
+    uint32_t mapHeight;
+    uint32_t cellDataOffset;
+};
+
+void CompileJsonMapToOsmap(const std::string &jsonMapPath, const std::string &osmapPath);
+OsmapHeader ReadOsmapHeader(const MappedFile &mappedFile, const std::string &filePath);
+void BuildMapFromOsmap(GameContext *gameContext, const std::string &filePath, const std::string &mapName);
+std::string GetCompiledMapPath(const std::string &mapName);
\ No newline at end of file
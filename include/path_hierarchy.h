@@ -0,0 +1,48 @@
+#pragma once
+
+#include "path_search.h"
+#include "thread_pool.h"
+
+// A crossing between two neighbouring clusters: cellIdxA lies in the west or north cluster, cellIdxB next to it in the
+// east or south one
+struct PathEntrance
+{
+    Vector2i cellIdxA;
+    Vector2i cellIdxB;
+    int costAToBSupplies;
+    int costBToASupplies;
+};
+
+enum PathClusterSides : uint8_t
+{
+    PATH_CLUSTER_WEST,
+    PATH_CLUSTER_EAST,
+    PATH_CLUSTER_NORTH,
+    PATH_CLUSTER_SOUTH,
+    PATH_CLUSTER_SIDE_COUNT,
+};
+
+// One MapGrid chunk of the abstract graph. Its nodes are its own cells of the entrances on its four borders, grouped
+// by side in PathClusterSides order.
+struct PathCluster
+{
+    std::vector<Vector2i> nodeCellIdxs;
+    std::vector<int64_t> nodeCosts; // nodeCount x nodeCount search costs from row to column inside the cluster, -1 when unreachable
+    int sideNodeOffsets[PATH_CLUSTER_SIDE_COUNT + 1] = {};
+    int firstNodeId = 0;
+    uint32_t navVersion = 0; // MapGrid::chunkNavVersions entry the cluster was built from
+};
+
+// HPA* abstraction of the movement graph with one cluster per MapGrid chunk. Units are ignored until a path is refined.
+struct PathHierarchy
+{
+    int clustersX = 0;
+    int clustersY = 0;
+    std::vector<PathCluster> clusters;
+    std::vector<std::vector<PathEntrance>> eastBorders;  // between clusters (x, y) and (x + 1, y), at y * clustersX + x
+    std::vector<std::vector<PathEntrance>> southBorders; // between clusters (x, y) and (x, y + 1)
+    std::vector<int> nodeClusterIdxs;                    // by node id
+};
+
+void UpdatePathHierarchy(const MapGrid &mapGrid, const MoveRules &moveRules, ThreadPool &threadPool, PathHierarchy &hierarchy);
+MovePath FindHierarchicalPath(const MapGrid &mapGrid, const MoveRules &moveRules, const PathHierarchy &hierarchy, PathSearchBuffer &buffer, const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies);
\ No newline at end of file
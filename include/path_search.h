@@ -0,0 +1,270 @@
+#pragma once
+
+#include "map_grid.h"
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Movement rules shared by every path search, loaded from the move_config section of game_setup.json
+struct MoveRules
+{
+    int maxClimbLevels = 1;      // steepest terrain level change a single step may take
+    int climbCostSupplies = 1;   // extra supplies per terrain level climbed
+    int minMoveCostSupplies = 0; // cheapest cell to step into; scales the A* heuristic, so it must never overestimate
+};
+
+// Path search costs order by supplies first and path length second: supplies << PATH_SUPPLY_COST_SHIFT + length. Ordering
+// by length after supplies makes the straightest of equally cheap routes win.
+constexpr int PATH_SUPPLY_COST_SHIFT = 32;
+constexpr int PATH_STEP_LENGTH_ORTHOGONAL = 10;
+constexpr int PATH_STEP_LENGTH_DIAGONAL = 14;
+
+inline int64_t MakePathSearchCost(const int64_t &supplies, const int64_t &length)
+{
+    return (supplies << PATH_SUPPLY_COST_SHIFT) + length;
+}
+
+inline int64_t GetStepSearchCost(const int &stepSupplies, const int &direction)
+{
+    return MakePathSearchCost(stepSupplies, direction % 2 == 1 ? PATH_STEP_LENGTH_DIAGONAL : PATH_STEP_LENGTH_ORTHOGONAL);
+}
+
+struct MovePath
+{
+    bool found = false;
+    int supplyCost = 0;
+    std::vector<Vector2i> cellIdxs; // excludes the start cell, so the path can go straight into MovePoints
+};
+
+// Octile distance for the length, Chebyshev steps at the cheapest move cost for the supplies
+inline int64_t GetPathHeuristicCost(const MoveRules &moveRules, const Vector2i &cellIdx, const Vector2i &goalCellIdx)
+{
+    int dx = std::abs(goalCellIdx.x - cellIdx.x);
+    int dy = std::abs(goalCellIdx.y - cellIdx.y);
+    int steps = std::max(dx, dy);
+    int diagonalSteps = std::min(dx, dy);
+    return MakePathSearchCost(static_cast<int64_t>(steps) * moveRules.minMoveCostSupplies, static_cast<int64_t>(steps) * PATH_STEP_LENGTH_ORTHOGONAL + static_cast<int64_t>(diagonalSteps) * (PATH_STEP_LENGTH_DIAGONAL - PATH_STEP_LENGTH_ORTHOGONAL));
+}
+
+struct PathHeapNode
+{
+    int64_t estimatedCost;
+    int x;
+    int y;
+};
+
+// Comparator for the std::push_heap/pop_heap min-heaps of the searches
+inline bool IsPathHeapNodeWorse(const PathHeapNode &a, const PathHeapNode &b)
+{
+    return a.estimatedCost > b.estimatedCost;
+}
+
+struct PathNodeHeapEntry
+{
+    int64_t estimatedCost;
+    int nodeId;
+};
+
+// Scratch memory of one search thread, sized to the map. A cell's entries only count when its stamp belongs to the
+// current search, so consecutive searches never have to clear them.
+struct PathSearchBuffer
+{
+    std::vector<int64_t> costs;            // best known search cost from the start
+    std::vector<uint8_t> parentDirections; // direction of the step that reached the cell
+    std::vector<uint32_t> stamps;          // openStamp: cost is valid, openStamp + 1: cell is closed
+    std::vector<PathHeapNode> openHeap;
+    uint32_t openStamp = 0;
+
+    void BeginSearch(const size_t &cellCount)
+    {
+        if (stamps.size() != cellCount)
+        {
+            costs.assign(cellCount, 0);
+            parentDirections.assign(cellCount, 0);
+            stamps.assign(cellCount, 0);
+            openStamp = 0;
+        }
+        if (openStamp >= UINT32_MAX - 2)
+        {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            openStamp = 0;
+        }
+        openStamp += 2;
+        openHeap.clear();
+    }
+
+    // The same for searches over the nodes of a PathHierarchy
+    std::vector<int64_t> nodeCosts;
+    std::vector<int> nodeParents;
+    std::vector<uint32_t> nodeStamps;
+    std::vector<PathNodeHeapEntry> nodeOpenHeap;
+    uint32_t nodeOpenStamp = 0;
+
+    void BeginNodeSearch(const size_t &nodeCount)
+    {
+        if (nodeStamps.size() != nodeCount)
+        {
+            nodeCosts.assign(nodeCount, 0);
+            nodeParents.assign(nodeCount, -1);
+            nodeStamps.assign(nodeCount, 0);
+            nodeOpenStamp = 0;
+        }
+        if (nodeOpenStamp >= UINT32_MAX - 2)
+        {
+            std::fill(nodeStamps.begin(), nodeStamps.end(), 0);
+            nodeOpenStamp = 0;
+        }
+        nodeOpenStamp += 2;
+        nodeOpenHeap.clear();
+    }
+};
+
+// Cheapest way from one origin to every cell it can reach within a supply budget, stored for a window around the
+// origin that covers every cell the budget could pay for. Units keep theirs as a component (see
+// GetUnitReachability), so range overlays, path previews and click validation all read one search.
+struct ReachabilityField
+{
+    Vector2i originCellIdx = {-1, -1};
+    int maxSupplies = -1;
+    uint32_t navVersion = 0;
+    uint32_t occupancyVersion = 0;
+
+    Vector2i minCellIdx = {0, 0};
+    int windowWidth = 0;
+    int windowHeight = 0;
+    std::vector<int64_t> costs; // search cost from the origin, -1 when the cell is out of reach
+    std::vector<uint8_t> parentDirections;
+    std::vector<uint8_t> canStop; // cliffs can be crossed but not stopped on
+
+    bool isRequestPending = false; // a recomputation was requested from the PathService and has not arrived yet
+
+    bool IsUpToDate(const MapGrid &mapGrid, const Vector2i &cellIdx, const int &supplies) const
+    {
+        return originCellIdx == cellIdx && maxSupplies == supplies && navVersion == mapGrid.navVersion && occupancyVersion == mapGrid.occupancyVersion;
+    }
+
+    // A field searched with a larger budget still holds the cheapest paths, so it can answer for a unit that spent
+    // supplies since, as long as callers check the unit can still afford the path
+    bool CoversBudget(const MapGrid &mapGrid, const Vector2i &cellIdx, const int &supplies) const
+    {
+        return originCellIdx == cellIdx && maxSupplies >= supplies && navVersion == mapGrid.navVersion && occupancyVersion == mapGrid.occupancyVersion;
+    }
+
+    // -1 outside the window
+    int GetWindowIdx(const Vector2i &cellIdx) const
+    {
+        int x = cellIdx.x - minCellIdx.x;
+        int y = cellIdx.y - minCellIdx.y;
+        if (x < 0 || y < 0 || x >= windowWidth || y >= windowHeight)
+        {
+            return -1;
+        }
+        return y * windowWidth + x;
+    }
+
+    // Supplies it costs to move to cellIdx and stop there, or -1 when that is not possible
+    int GetSupplyCost(const Vector2i &cellIdx) const
+    {
+        int windowIdx = GetWindowIdx(cellIdx);
+        if (windowIdx < 0 || costs[windowIdx] < 0 || !canStop[windowIdx])
+        {
+            return -1;
+        }
+        return static_cast<int>(costs[windowIdx] >> PATH_SUPPLY_COST_SHIFT);
+    }
+
+    MovePath GetPath(const Vector2i &cellIdx) const
+    {
+        MovePath path;
+        path.supplyCost = GetSupplyCost(cellIdx);
+        if (path.supplyCost < 0)
+        {
+            path.supplyCost = 0;
+            return path;
+        }
+
+        path.found = true;
+        Vector2i pathCellIdx = cellIdx;
+        while (!(pathCellIdx == originCellIdx))
+        {
+            path.cellIdxs.push_back(pathCellIdx);
+            int direction = parentDirections[GetWindowIdx(pathCellIdx)];
+            pathCellIdx = {pathCellIdx.x - COVER_DIRECTION_OFFSETS_X[direction], pathCellIdx.y - COVER_DIRECTION_OFFSETS_Y[direction]};
+        }
+        std::reverse(path.cellIdxs.begin(), path.cellIdxs.end());
+        return path;
+    }
+};
+
+// A unit's route to a goal further away than it can move this turn. Units keep their last one as a component (see
+// GetUnitLongMovePath), so a hovered goal is searched once instead of every frame.
+struct LongMovePath
+{
+    Vector2i startCellIdx = {-1, -1};
+    Vector2i goalCellIdx = {-1, -1};
+    uint32_t navVersion = 0;
+    uint32_t occupancyVersion = 0;
+    MovePath path;
+
+    bool isRequestPending = false; // a search was requested from the PathService and has not arrived yet
+
+    bool IsUpToDate(const MapGrid &mapGrid, const Vector2i &cellIdx, const Vector2i &goal) const
+    {
+        return startCellIdx == cellIdx && goalCellIdx == goal && navVersion == mapGrid.navVersion && occupancyVersion == mapGrid.occupancyVersion;
+    }
+};
+
+// Units may end a move on any cell but a cliff
+inline bool IsStandableCell(const MapGrid &mapGrid, const int &idx)
+{
+    return !(mapGrid.cellFlags[idx] & CELL_FLAG_CLIFF);
+}
+
+// Whether a step may join cells at these terrain levels; diagonal steps also ask it of the two cells beside them
+inline bool IsClimbAllowed(const MoveRules &moveRules, const int &fromLevel, const int &toLevel)
+{
+    return std::abs(toLevel - fromLevel) <= moveRules.maxClimbLevels;
+}
+
+inline int GetClimbCostSupplies(const MoveRules &moveRules, const int &fromLevel, const int &toLevel)
+{
+    return std::max(toLevel - fromLevel, 0) * moveRules.climbCostSupplies;
+}
+
+// Supplies it costs to step from cellIdx in direction (indexing the COVER_DIRECTION_OFFSETS tables), or -1 when the
+// step leaves the map, climbs too far or cuts the corner of a cell it could not step into. Unit occupancy is left to
+// the caller.
+inline int GetStepCostSupplies(const MapGrid &mapGrid, const MoveRules &moveRules, const Vector2i &cellIdx, const int &direction, int &outToIdx)
+{
+    Vector2i toCellIdx = {cellIdx.x + COVER_DIRECTION_OFFSETS_X[direction], cellIdx.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+    if (!mapGrid.InBounds(toCellIdx))
+    {
+        return -1;
+    }
+
+    int fromLevel = mapGrid.terrainLevels[mapGrid.CellToIndex(cellIdx)];
+    outToIdx = mapGrid.CellToIndex(toCellIdx);
+    int toLevel = mapGrid.terrainLevels[outToIdx];
+    if (!IsClimbAllowed(moveRules, fromLevel, toLevel))
+    {
+        return -1;
+    }
+
+    if (direction % 2 == 1)
+    {
+        int sideLevels[2] = {mapGrid.terrainLevels[mapGrid.CellToIndex({toCellIdx.x, cellIdx.y})],
+                             mapGrid.terrainLevels[mapGrid.CellToIndex({cellIdx.x, toCellIdx.y})]};
+        for (int sideLevel : sideLevels)
+        {
+            if (!IsClimbAllowed(moveRules, fromLevel, sideLevel) || !IsClimbAllowed(moveRules, toLevel, sideLevel))
+            {
+                return -1;
+            }
+        }
+    }
+
+    return mapGrid.moveCosts[outToIdx] + GetClimbCostSupplies(moveRules, fromLevel, toLevel);
+}
+
+MovePath FindPath(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies);
+void ComputeReachability(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &originCellIdx, const int &maxSupplies, ReachabilityField &field);
\ No newline at end of file
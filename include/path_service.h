@@ -0,0 +1,113 @@
+#pragma once
+
+#include "path_hierarchy.h"
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+enum struct PathJobKinds : uint8_t
+{
+    MOVE_PATH,
+    REACHABILITY,
+};
+
+// Identical requests against the same movement state share one search
+struct PathJobKey
+{
+    PathJobKinds kind;
+    Vector2i startCellIdx;
+    Vector2i goalCellIdx; // {-1, -1} for reachability
+    int maxSupplies;
+    uint32_t navVersion;
+    uint32_t occupancyVersion;
+
+    bool operator==(const PathJobKey &other) const
+    {
+        return kind == other.kind && startCellIdx == other.startCellIdx && goalCellIdx == other.goalCellIdx && maxSupplies == other.maxSupplies &&
+               navVersion == other.navVersion && occupancyVersion == other.occupancyVersion;
+    }
+};
+
+struct PathJobKeyHash
+{
+    size_t operator()(const PathJobKey &key) const
+    {
+        uint64_t hash = static_cast<uint64_t>(key.kind);
+        for (uint64_t value : {static_cast<uint64_t>(static_cast<uint32_t>(key.startCellIdx.x)), static_cast<uint64_t>(static_cast<uint32_t>(key.startCellIdx.y)),
+                               static_cast<uint64_t>(static_cast<uint32_t>(key.goalCellIdx.x)), static_cast<uint64_t>(static_cast<uint32_t>(key.goalCellIdx.y)),
+                               static_cast<uint64_t>(static_cast<uint32_t>(key.maxSupplies)), static_cast<uint64_t>(key.navVersion), static_cast<uint64_t>(key.occupancyVersion)})
+        {
+            hash = (hash ^ value) * 0x100000001B3ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct PathJob
+{
+    PathJobKey key;
+    MovePath path;
+    ReachabilityField field;
+    std::atomic<bool> isDone{false};
+};
+
+// Runs path and reachability searches on worker threads of its own, so neither the render thread nor the shared
+// ThreadPool ever waits on a long search. Requests are deduplicated by PathJobKey, answered from finished searches
+// while the movement state stays the same, and their callbacks run on the main thread inside Poll.
+//
+// Searches read the MapGrid and PathHierarchy without copying them: anything that changes cells, units or the
+// hierarchy must hold LockWorld, which waits for running searches and keeps new ones from starting.
+class PathService
+{
+public:
+    using PathCallback = std::function<void(const MovePath &)>;
+    using ReachabilityCallback = std::function<void(const ReachabilityField &)>;
+
+    // Holds off searches: the turnstile stops new ones, the exclusive lock waits for running ones
+    struct WorldWriteLock
+    {
+        std::unique_lock<std::mutex> turnstile;
+        std::unique_lock<std::shared_mutex> world;
+    };
+
+    PathService(const MapGrid &mapGrid, const MoveRules &moveRules, PathHierarchy &pathHierarchy, ThreadPool &threadPool, unsigned int workerCount = 2);
+    ~PathService();
+
+    PathService(const PathService &) = delete;
+    PathService &operator=(const PathService &) = delete;
+
+    // Main thread only
+    void RequestPath(const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies, PathCallback onDone);
+    void RequestReachability(const Vector2i &originCellIdx, const int &maxSupplies, ReachabilityCallback onDone);
+    void Poll();
+    void UpdateHierarchy();
+    WorldWriteLock LockWorld();
+
+private:
+    struct PathWaiter
+    {
+        std::shared_ptr<PathJob> job;
+        PathCallback onPath;
+        ReachabilityCallback onReachability;
+    };
+
+    const MapGrid &mapGrid;
+    const MoveRules &moveRules;
+    PathHierarchy &pathHierarchy;
+    ThreadPool &threadPool; // for rebuilding the hierarchy; searches never run on it
+    uint32_t hierarchyNavVersion = 0;
+    bool isHierarchyBuilt = false;
+
+    std::unordered_map<PathJobKey, std::shared_ptr<PathJob>, PathJobKeyHash> jobs; // queued, running and finished
+    std::vector<std::shared_ptr<PathJob>> queuedJobs;                                // started by the next Poll
+    std::vector<PathWaiter> waiters;
+
+    std::mutex turnstileMutex;
+    std::shared_mutex worldMutex;
+    std::atomic<bool> isStopping{false};
+
+    ThreadPool workers; // last, so it is joined before anything its tasks touch goes away
+
+    std::shared_ptr<PathJob> FindOrQueueJob(const PathJobKey &key);
+    void RunJob(PathJob &job);
+};
\ No newline at end of file
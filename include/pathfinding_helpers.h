@@ -0,0 +1,8 @@
+#pragma once
+
+#include "game_context.h"
+
+const ReachabilityField &GetUnitReachability(GameContext *gameContext, const entt::entity &unitEntity);
+const LongMovePath &GetUnitLongMovePath(GameContext *gameContext, const entt::entity &unitEntity, const Vector2i &goalCellIdx);
+MovePath GetMovePathPrefix(const GameContext *gameContext, const Vector2i &startCellIdx, const MovePath &path, const int &maxSupplies, const int &maxDistance);
+std::vector<entt::entity> OrderGroupMove(GameContext *gameContext, const std::vector<entt::entity> &unitEntities, const std::vector<int> &unitMaxSupplies, const Vector2i &goalCellIdx);
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "components.h"
+#include "json.hpp"
+
+AbilityDef CompileAbilityDef(const nlohmann::json &abilityData);
+ObstacleTemplate CompileObstacleTemplate(const std::string &type, const nlohmann::json &templateData);
+UnitTemplate CompileUnitTemplate(const std::string &type, const nlohmann::json &templateData, std::vector<AbilityDef> &abilityDefs);
\ No newline at end of file
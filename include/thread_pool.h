@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one task queue. ParallelFor must not be called from inside a pool task.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Worker threads plus the calling thread, which always helps with ParallelFor
+    int GetThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    void Submit(std::function<void()> task);
+
+    // Splits [0, count) into contiguous batches of at least minBatchSize and runs func(begin, end) on each.
+    // Blocks until every batch is done and rethrows the first exception a batch threw.
+    template <typename Func>
+    void ParallelFor(const int &count, const int &minBatchSize, Func &&func)
+    {
+        if (count <= 0)
+        {
+            return;
+        }
+
+        int batchCount = std::min((count + std::max(minBatchSize, 1) - 1) / std::max(minBatchSize, 1), GetThreadCount() * 4);
+        if (batchCount <= 1 || workers.empty())
+        {
+            func(0, count);
+            return;
+        }
+
+        std::atomic<int> nextBatch{0};
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        std::exception_ptr firstError;
+        int helperCount = std::min(static_cast<int>(workers.size()), batchCount - 1);
+        int activeHelpers = helperCount;
+
+        auto runBatches = [&]()
+        {
+            for (int batch = nextBatch.fetch_add(1); batch < batchCount; batch = nextBatch.fetch_add(1))
+            {
+                int begin = static_cast<int>(static_cast<long long>(count) * batch / batchCount);
+                int end = static_cast<int>(static_cast<long long>(count) * (batch + 1) / batchCount);
+                try
+                {
+                    func(begin, end);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    if (!firstError)
+                    {
+                        firstError = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        for (int i = 0; i < helperCount; i++)
+        {
+            Submit([&]()
+                   {
+                       runBatches();
+                       std::lock_guard<std::mutex> lock(doneMutex);
+                       if (--activeHelpers == 0)
+                       {
+                           doneCondition.notify_one();
+                       } });
+        }
+
+        runBatches();
+
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&]()
+                           { return activeHelpers == 0; });
+        if (firstError)
+        {
+            std::rethrow_exception(firstError);
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksCondition;
+    bool stopping = false;
+
+    void WorkerLoop();
+};
\ No newline at end of file
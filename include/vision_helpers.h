@@ -0,0 +1,12 @@
+#pragma once
+
+#include "game_context.h"
+
+void GetVisionBounds(const GameContext *gameContext, const IsoscelesTrapezoid &visionTrap, Vector2i &minCellIdx, Vector2i &maxCellIdx);
+bool IsViewshedStale(const GameContext *gameContext, const Unit &unitComp, const IsoscelesTrapezoid &visionTrap, const Viewshed &viewshed);
+void ComputeViewshed(const GameContext *gameContext, const Unit &unitComp, const IsoscelesTrapezoid &visionTrap, Viewshed &viewshed);
+int UpdateViewsheds(GameContext *gameContext, const std::vector<entt::entity> &unitEntities);
+void ReleaseViewshed(GameContext *gameContext, const Unit &unitComp, Viewshed &viewshed);
+
+bool IsCellVisibleToTeam(const GameContext *gameContext, const Teams &team, const Vector2i &cellIdx);
+bool IsUnitVisibleToMyTeam(const GameContext *gameContext, const entt::entity &unitEntity);
\ No newline at end of file
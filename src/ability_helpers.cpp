@@ -1,9 +1,58 @@
 #include "ability_helpers.h"
+#include "cover_helpers.h"
 #include "map_helpers.h"
+#include "los_helpers.h"
 #include "math_helpers.h"
+#include "pathfinding_helpers.h"
 #include "unit_helpers.h"
 #include "ui_helpers.h"
 
+// Why the unit cannot use the ability on targetCellIdx right now, or nullptr when it can
+const char *GetAbilityUseError(const GameContext *gameContext, const Unit &unitComp, const AbilityDef &abilityDef, const AbilityState &abilityState, const Vector2i &targetCellIdx)
+{
+    if (abilityDef.supplyCost > unitComp.supplies)
+    {
+        return "Not enough supplies";
+    }
+
+    if (abilityDef.maxUsesPerTurn > -1 && abilityState.usesThisTurn >= abilityDef.maxUsesPerTurn)
+    {
+        return "Ability max uses per turn reached";
+    }
+
+    if (abilityDef.maxCooldown > -1 && gameContext->turnCount - abilityState.lastTurnUsed < abilityDef.maxCooldown)
+    {
+        return "Ability on cooldown";
+    }
+
+    if (abilityDef.range > -1 && GetChebyshevDistance(unitComp.cellIdx, targetCellIdx) > abilityDef.range)
+    {
+        return "Ability out of range";
+    }
+
+    return nullptr;
+}
+
+// The unit's first ability of abilityType, or nullptr when it has none
+static AbilityState *FindUnitAbility(const GameContext *gameContext, Unit &unitComp, const std::string &abilityType)
+{
+    for (AbilityState &abilityState : unitComp.abilities)
+    {
+        if (gameContext->GetAbilityDef(abilityState).type == abilityType)
+        {
+            return &abilityState;
+        }
+    }
+    return nullptr;
+}
+
+void SpendAbilityUse(const GameContext *gameContext, Unit &unitComp, const AbilityDef &abilityDef, AbilityState &abilityState)
+{
+    abilityState.usesThisTurn++;
+    abilityState.lastTurnUsed = gameContext->turnCount;
+    unitComp.supplies -= abilityDef.supplyCost;
+}
+
 void sCycleSelectedAbility(GameContext *gameContext)
 {
     if (gameContext->selectedUnit != entt::null)
@@ -24,17 +73,14 @@ void sCycleSelectedAbility(GameContext *gameContext)
                 if (newIdx > abilitiesSize) // Beyond the last ability
                 {
                     selectedUnitComp.selectedAbilityIdx = -1; // Neutral spot
-                    selectedUnitComp.selectedAbility = nullptr;
                 }
                 else if (newIdx == abilitiesSize) // Last ability to neutral
                 {
                     selectedUnitComp.selectedAbilityIdx = -1; // Neutral spot
-                    selectedUnitComp.selectedAbility = nullptr;
                 }
                 else // Valid ability index
                 {
                     selectedUnitComp.selectedAbilityIdx = newIdx;
-                    selectedUnitComp.selectedAbility = &abilities[newIdx];
                 }
             }
 
@@ -48,17 +94,14 @@ void sCycleSelectedAbility(GameContext *gameContext)
                 if (newIdx < -1) // Below neutral spot, wrap to the last ability
                 {
                     selectedUnitComp.selectedAbilityIdx = abilitiesSize - 1;
-                    selectedUnitComp.selectedAbility = &abilities[abilitiesSize - 1];
                 }
                 else if (newIdx == -1) // Back to the neutral spot
                 {
                     selectedUnitComp.selectedAbilityIdx = -1;
-                    selectedUnitComp.selectedAbility = nullptr;
                 }
                 else // Valid ability index
                 {
                     selectedUnitComp.selectedAbilityIdx = newIdx;
-                    selectedUnitComp.selectedAbility = &abilities[newIdx];
                 }
             }
         }
@@ -75,12 +118,14 @@ void sUseAbilities(GameContext *gameContext)
     entt::entity selectedUnitEntity = gameContext->selectedUnit;
     auto &selectedUnitComp = gameContext->registry.get<Unit>(selectedUnitEntity);
 
-    if (selectedUnitComp.selectedAbility == nullptr)
+    const AbilityDef *selectedAbility = gameContext->GetSelectedAbilityDef(selectedUnitComp);
+    if (selectedAbility == nullptr)
     {
         return;
     }
+    AbilityState &selectedAbilityState = selectedUnitComp.abilities[selectedUnitComp.selectedAbilityIdx];
 
-    if (selectedUnitComp.selectedAbility->requiresCell && !CheckMouseInMapBounds(gameContext))
+    if (selectedAbility->requiresCell && !CheckMouseInMapBounds(gameContext))
     {
         return;
     }
@@ -96,62 +141,55 @@ void sUseAbilities(GameContext *gameContext)
     Vector2 mouseRectCenter = GetRectCenter(Rectangle{mouseRectCellIdxToWorld.x, mouseRectCellIdxToWorld.y, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)});
 
     int chebDist = GetChebyshevDistance(selectedUnitComp.cellIdx, mousePosCellIdx);
+    bool isMoveAbility = selectedAbility->type == "move";
 
-    if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON))
+    // Moves are checked and paid for below, once there is a path to send each unit along
+    if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) && !isMoveAbility)
     {
-        if (selectedUnitComp.selectedAbility->supplyCost > selectedUnitComp.supplies)
-        {
-            std::cout << "Not enough supplies" << std::endl;
-            return;
-        }
-
-        if (selectedUnitComp.selectedAbility->maxUsesPerTurn > -1 && selectedUnitComp.selectedAbility->usesThisTurn >= selectedUnitComp.selectedAbility->maxUsesPerTurn)
-        {
-            std::cout << "Ability max uses per turn reached" << std::endl;
-            return;
-        }
-
-        if (selectedUnitComp.selectedAbility->maxCooldown > -1 && gameContext->turnCount - selectedUnitComp.selectedAbility->lastTurnUsed < selectedUnitComp.selectedAbility->maxCooldown)
-        {
-            std::cout << "Ability on cooldown" << std::endl;
-            return;
-        }
-
-        if (selectedUnitComp.selectedAbility->range > -1 && chebDist > selectedUnitComp.selectedAbility->range)
+        const char *useError = GetAbilityUseError(gameContext, selectedUnitComp, *selectedAbility, selectedAbilityState, mousePosCellIdx);
+        if (useError != nullptr)
         {
-            std::cout << "Ability out of range" << std::endl;
+            std::cout << useError << std::endl;
             return;
         }
-
-        selectedUnitComp.selectedAbility->usesThisTurn++;
-        selectedUnitComp.selectedAbility->lastTurnUsed = gameContext->turnCount;
-        selectedUnitComp.supplies -= selectedUnitComp.selectedAbility->supplyCost;
+        SpendAbilityUse(gameContext, selectedUnitComp, *selectedAbility, selectedAbilityState);
     }
 
     BeginMode2D(gameContext->camera);
     const CellSummary selectedUnitCellSummary = GetCellSummary(gameContext, selectedUnitComp.cellIdx);
-    int currMoveCost = 0;
-    std::vector<Vector2i> finalMovePoints;
-    std::vector<Vector2i> bresenhamCells;
-    // NOTE: Bresenham's is only used for the "move" ability
-    if (selectedUnitComp.selectedAbility->doesBresenhamTargeting)
+    MovePath movePath;
+    // NOTE: Path targeting is only used for the "move" ability
+    if (selectedAbility->doesBresenhamTargeting)
     {
-        bresenhamCells = GetBresenhamCells(selectedUnitComp.cellIdx, mousePosCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-        bresenhamCells.erase(bresenhamCells.begin()); // Remove the first cell, since we don't count the unit's cell
-
-        for (auto &cell : bresenhamCells)
+        // The field may still be on its way from the path service, in which case there is no path to order yet
+        const ReachabilityField &reachability = GetUnitReachability(gameContext, selectedUnitEntity);
+        int moveSupplies = selectedUnitComp.supplies - selectedAbility->supplyCost;
+        bool isReachabilityReady = reachability.CoversBudget(gameContext->mapGrid, selectedUnitComp.cellIdx, selectedUnitComp.supplies);
+        if (isReachabilityReady && (selectedAbility->range < 0 || chebDist <= selectedAbility->range))
         {
-            const CellSummary cellSummary = GetCellSummary(gameContext, cell);
-            if (cellSummary.obstacle != entt::null)
+            movePath = reachability.GetPath(mousePosCellIdx);
+            if (movePath.supplyCost > moveSupplies)
             {
-                auto &obstacleComp = gameContext->registry.get<Obstacle>(cellSummary.obstacle);
-                currMoveCost += obstacleComp.moveCostSupplies;
+                movePath = MovePath();
             }
-            if (chebDist > selectedUnitComp.selectedAbility->range || currMoveCost > selectedUnitComp.supplies)
+        }
+
+        // Goals the unit cannot get to this turn show the way there, and the unit walks as far along it as the move's
+        // range and its supplies allow
+        if (isReachabilityReady && movePath.cellIdxs.empty() && chebDist > 0 && CheckCellInMapBounds(gameContext, mousePosCellIdx))
+        {
+            const LongMovePath &longMovePath = GetUnitLongMovePath(gameContext, selectedUnitEntity, mousePosCellIdx);
+            if (longMovePath.IsUpToDate(gameContext->mapGrid, selectedUnitComp.cellIdx, mousePosCellIdx))
             {
-                break;
+                for (auto &cell : longMovePath.path.cellIdxs)
+                {
+                    DrawRectangleRec({static_cast<float>(cell.x) * gameContext->cellWidth, static_cast<float>(cell.y) * gameContext->cellHeight, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)}, Fade(BLUE, 0.1f));
+                }
+                movePath = GetMovePathPrefix(gameContext, selectedUnitComp.cellIdx, longMovePath.path, moveSupplies, selectedAbility->range);
             }
-            finalMovePoints.push_back(cell);
+        }
+        for (auto &cell : movePath.cellIdxs)
+        {
             DrawRectangleRec({static_cast<float>(cell.x) * gameContext->cellWidth, static_cast<float>(cell.y) * gameContext->cellHeight, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)}, Fade(BLUE, 0.2f));
         }
     }
@@ -160,7 +198,16 @@ void sUseAbilities(GameContext *gameContext)
     Vector2i finalCellIdx = mousePosCellIdx;
     Vector2 finalCenter = mouseRectCenter;
     float accuracyP = 1.0;
-    accuracyP -= chebDist * selectedUnitComp.selectedAbility->accuracyFalloff;
+    accuracyP -= chebDist * selectedAbility->accuracyFalloff;
+    // Partial cover: the fewer LOS samples of the unit's cell reach the target, or the more of the target its
+    // directional cover hides, the harder the shot
+    MultiSampleLOSResult aimedLOS;
+    if (selectedAbility->doesStraightLineTargeting)
+    {
+        aimedLOS = TraceMultiSampleLOS(gameContext, selectedUnitComp.cellIdx, mousePosCellIdx, false);
+        float hiddenFraction = std::max(1.0f - aimedLOS.GetVisibleFraction(), GetUnitCoverFraction(gameContext, mousePosCellIdx, selectedUnitComp.cellIdx));
+        accuracyP -= gameContext->losCoverAccuracyPenalty * hiddenFraction;
+    }
     bool didAccRollSucceed = true;
     if (!Chance(accuracyP))
     {
@@ -169,9 +216,9 @@ void sUseAbilities(GameContext *gameContext)
     // TODO: create "miss" popup at desired target if acc roll fails
     if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))
     {
-        if (selectedUnitComp.selectedAbility->inaccuracyRadius > 0)
+        if (selectedAbility->inaccuracyRadius > 0)
         {
-            Rectangle rect = GenerateCellNeighborRect(selectedUnitComp.cellIdx, selectedUnitComp.selectedAbility->inaccuracyRadius, gameContext->cellWidth, gameContext->cellHeight);
+            Rectangle rect = GenerateCellNeighborRect(selectedUnitComp.cellIdx, selectedAbility->inaccuracyRadius, gameContext->cellWidth, gameContext->cellHeight);
             std::vector<Vector2i> cellsInInaccuracyRadius = DeduceCellIdxsOverlappingRect(rect, gameContext->cellWidth, gameContext->cellHeight);
             if (!didAccRollSucceed)
             {
@@ -186,43 +233,22 @@ void sUseAbilities(GameContext *gameContext)
 
     CellSummary finalCellSummary = GetCellSummary(gameContext, finalCellIdx);
 
-    // TODO: Implement corner->corner casting for more forgiving LOS
-    std::vector<Vector2i> straightLineCells;
-    Vector2i blockingCellIdx = {-1, -1};
-    if (selectedUnitComp.selectedAbility->doesStraightLineTargeting)
+    // Forgiving LOS: the shot goes through when any sample of the unit's cell sees the target
+    if (selectedAbility->doesStraightLineTargeting)
     {
-        straightLineCells = GetCellsOverlappingLine(selectedUnitCenter, finalCenter, gameContext->cellWidth, gameContext->cellHeight);
-        straightLineCells.erase(straightLineCells.begin()); // Remove the first cell, since we don't count the unit's cell
-
-        for (auto &cell : straightLineCells)
+        MultiSampleLOSResult los = finalCellIdx == mousePosCellIdx ? aimedLOS : TraceMultiSampleLOS(gameContext, selectedUnitComp.cellIdx, finalCellIdx, true);
+        if (!los.IsAnyVisible())
         {
-            const CellSummary cellSummary = GetCellSummary(gameContext, cell);
-            if (cellSummary.obstacle != entt::null)
-            {
-                auto &obstacleComp = gameContext->registry.get<Obstacle>(cellSummary.obstacle);
-            }
-            // DrawRectangleRec({static_cast<float>(cell.x) * gameContext->cellWidth, static_cast<float>(cell.y) * gameContext->cellHeight, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)}, Fade(BLUE, 0.2f));
-
-            blockingCellIdx = HasElevationLOS(gameContext, 3.28f, selectedUnitComp.cellIdx, mousePosCellIdx, cell);
-            if (blockingCellIdx.x != -1 && blockingCellIdx.y != -1)
-            {
-                // There is a blocking cell
-                finalCellIdx = blockingCellIdx;
-                Vector2 finalCellIdxToWorld = MapToWorld(finalCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-                finalCenter = GetRectCenter(Rectangle{finalCellIdxToWorld.x, finalCellIdxToWorld.y, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)});
-                Circle blockingIndicator = GenerateGridBoundCircle(finalCenter, 0, gameContext->cellWidth, gameContext->cellHeight);
-                if (blockingCellIdx.x != mousePosCellIdx.x && blockingCellIdx.y != mousePosCellIdx.y)
-                {
-                    // DrawCircle(blockingIndicator.centerPos.x, blockingIndicator.centerPos.y, blockingIndicator.radius, BLACK);
-                }
-                break;
-            }
+            // There is a blocking cell
+            finalCellIdx = los.blockingCell;
+            Vector2 finalCellIdxToWorld = MapToWorld(finalCellIdx, gameContext->cellWidth, gameContext->cellHeight);
+            finalCenter = GetRectCenter(Rectangle{finalCellIdxToWorld.x, finalCellIdxToWorld.y, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)});
         }
     }
 
-    // if (selectedUnitComp.selectedAbility->firesProjectile)
+    // if (selectedAbility->firesProjectile)
     // {
-    //     if (!selectedUnitComp.selectedAbility->isAerialProjectile)
+    //     if (!selectedAbility->isAerialProjectile)
     //     {
     //         // If prev acc roll failed, choose a random
     //     }
@@ -231,27 +257,64 @@ void sUseAbilities(GameContext *gameContext)
 
     if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))
     {
-        if (selectedUnitComp.selectedAbility->type == "move" && bresenhamCells.size() > 0)
+        if (isMoveAbility && !gameContext->selectedGroup.empty())
         {
-            bool finalIsCliff = false;
-            const CellSummary endCellSummary = GetCellSummary(gameContext, finalMovePoints.back());
-            if (endCellSummary.obstacle != entt::null)
-            {
-                auto &obstacleComp = gameContext->registry.get<Obstacle>(endCellSummary.obstacle);
-                obstacleComp.displayName == "cliff" ? finalIsCliff = true : finalIsCliff = false;
-            }
-            if (!finalIsCliff)
+            // The selected unit leads. Every unit must be able to use its own move ability on the goal, and pays for it
+            // and for its route only once it is given one.
+            std::vector<entt::entity> candidateEntities = {selectedUnitEntity};
+            candidateEntities.insert(candidateEntities.end(), gameContext->selectedGroup.begin(), gameContext->selectedGroup.end());
+            std::vector<entt::entity> groupEntities;
+            std::vector<int> groupMoveSupplies;
+            for (const entt::entity &unitEntity : candidateEntities)
             {
-                if (!gameContext->registry.all_of<MovePoints>(selectedUnitEntity))
+                if (!gameContext->registry.valid(unitEntity) || std::find(groupEntities.begin(), groupEntities.end(), unitEntity) != groupEntities.end())
+                {
+                    continue;
+                }
+                Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+                AbilityState *moveAbilityState = FindUnitAbility(gameContext, unitComp, "move");
+                if (moveAbilityState == nullptr)
+                {
+                    continue;
+                }
+                const AbilityDef &moveAbility = gameContext->GetAbilityDef(*moveAbilityState);
+                const char *useError = GetAbilityUseError(gameContext, unitComp, moveAbility, *moveAbilityState, mousePosCellIdx);
+                if (useError == nullptr)
+                {
+                    groupEntities.push_back(unitEntity);
+                    groupMoveSupplies.push_back(unitComp.supplies - moveAbility.supplyCost);
+                }
+                else if (unitEntity == selectedUnitEntity)
                 {
-                    gameContext->registry.emplace<MovePoints>(selectedUnitEntity, bresenhamCells);
-                    std::cout << "Supplies before move: " << " " << selectedUnitComp.supplies << " " << currMoveCost << std::endl;
-                    selectedUnitComp.supplies -= currMoveCost;
-                    std::cout << "Supplies after move: " << " " << selectedUnitComp.supplies << " " << currMoveCost << std::endl;
+                    std::cout << useError << std::endl;
                 }
             }
+
+            for (const entt::entity &unitEntity : OrderGroupMove(gameContext, groupEntities, groupMoveSupplies, mousePosCellIdx))
+            {
+                Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+                AbilityState *moveAbilityState = FindUnitAbility(gameContext, unitComp, "move");
+                SpendAbilityUse(gameContext, unitComp, gameContext->GetAbilityDef(*moveAbilityState), *moveAbilityState);
+            }
+        }
+        else if (isMoveAbility && movePath.cellIdxs.size() > 0)
+        {
+            // Checked against where the unit stops, which is within range even when the goal is not
+            const char *useError = GetAbilityUseError(gameContext, selectedUnitComp, *selectedAbility, selectedAbilityState, movePath.cellIdxs.back());
+            if (useError != nullptr)
+            {
+                std::cout << useError << std::endl;
+            }
+            else if (!gameContext->registry.all_of<MovePoints>(selectedUnitEntity))
+            {
+                gameContext->registry.emplace<MovePoints>(selectedUnitEntity, movePath.cellIdxs);
+                SpendAbilityUse(gameContext, selectedUnitComp, *selectedAbility, selectedAbilityState);
+                std::cout << "Supplies before move: " << " " << selectedUnitComp.supplies << " " << movePath.supplyCost << std::endl;
+                selectedUnitComp.supplies -= movePath.supplyCost;
+                std::cout << "Supplies after move: " << " " << selectedUnitComp.supplies << " " << movePath.supplyCost << std::endl;
+            }
         }
-        if (selectedUnitComp.selectedAbility->type == "rotate")
+        if (selectedAbility->type == "rotate")
         {
             auto visionTrapEntity = gameContext->registry.try_get<IsoscelesTrapezoid>(selectedUnitEntity);
             if (visionTrapEntity != nullptr)
@@ -265,7 +328,7 @@ void sUseAbilities(GameContext *gameContext)
                 PositionAllTrapezoids(gameContext);
             }
         }
-        if (selectedUnitComp.selectedAbility->firesProjectile && !selectedUnitComp.selectedAbility->isAerialProjectile)
+        if (selectedAbility->firesProjectile && !selectedAbility->isAerialProjectile)
         {
             // If accuracy failed, choose a random cell from the cells in the line
             // if (!didAccRollSucceed)
@@ -284,7 +347,7 @@ void sUseAbilities(GameContext *gameContext)
 
                 if (obstacleComp.isDestructible)
                 {
-                    int obstacleDamage = selectedUnitComp.selectedAbility->terrainDamageMin + std::rand() % (selectedUnitComp.selectedAbility->terrainDamageMax - selectedUnitComp.selectedAbility->terrainDamageMin + 1);
+                    int obstacleDamage = selectedAbility->terrainDamageMin + std::rand() % (selectedAbility->terrainDamageMax - selectedAbility->terrainDamageMin + 1);
                     obstacleComp.currentHealth -= obstacleDamage;
                     nlohmann::json netMessage = nlohmann::json::object({{"type", MessageTypes::UPDATE_OBSTACLE_HEALTH},
                                                                         {"from_team", gameContext->myPlayer.team},
@@ -301,12 +364,12 @@ void sUseAbilities(GameContext *gameContext)
 
                 if (unitComp.isPerson)
                 {
-                    finalUnitDamage = selectedUnitComp.selectedAbility->fleshDamageMin + std::rand() % (selectedUnitComp.selectedAbility->fleshDamageMax - selectedUnitComp.selectedAbility->fleshDamageMin + 1);
+                    finalUnitDamage = selectedAbility->fleshDamageMin + std::rand() % (selectedAbility->fleshDamageMax - selectedAbility->fleshDamageMin + 1);
                 }
 
                 if (unitComp.isStructure || unitComp.isVehicle)
                 {
-                    finalUnitDamage = selectedUnitComp.selectedAbility->armorDamageMin + std::rand() % (selectedUnitComp.selectedAbility->armorDamageMax - selectedUnitComp.selectedAbility->armorDamageMin + 1);
+                    finalUnitDamage = selectedAbility->armorDamageMin + std::rand() % (selectedAbility->armorDamageMax - selectedAbility->armorDamageMin + 1);
                 }
 
                 unitComp.currentHealth -= finalUnitDamage;
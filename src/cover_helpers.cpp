@@ -0,0 +1,36 @@
+#include "cover_helpers.h"
+#include "map_helpers.h"
+
+// Side of cellIdx that an attack from fromCellIdx arrives on, rounded to the nearest of the eight directions
+CoverDirections GetCoverDirection(const Vector2i &cellIdx, const Vector2i &fromCellIdx)
+{
+    // Clockwise angle from north; y grows downwards
+    float angle = std::atan2(static_cast<float>(fromCellIdx.x - cellIdx.x), static_cast<float>(cellIdx.y - fromCellIdx.y));
+    int sector = static_cast<int>(std::lround(angle / (M_PI / 4.0f)));
+    return static_cast<CoverDirections>((sector + COVER_DIRECTION_COUNT) % COVER_DIRECTION_COUNT);
+}
+
+// Height of the cover cellIdx offers against fire from fromCellIdx; 0 from inside the cell or off the map
+int GetCoverHeightAgainst(const GameContext *gameContext, const Vector2i &cellIdx, const Vector2i &fromCellIdx)
+{
+    if (cellIdx == fromCellIdx || !CheckCellInMapBounds(gameContext, cellIdx))
+    {
+        return 0;
+    }
+    return gameContext->mapGrid.GetCover(cellIdx, GetCoverDirection(cellIdx, fromCellIdx));
+}
+
+// Share (0 to 1) of the unit standing in cellIdx that its cover hides from fromCellIdx; 0 when the cell has no unit
+float GetUnitCoverFraction(const GameContext *gameContext, const Vector2i &cellIdx, const Vector2i &fromCellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
+    {
+        return 0.0f;
+    }
+    int unitHeight = GetUnitIntrinsicHeightForCellIdxUnchecked(gameContext, cellIdx);
+    if (unitHeight <= 0)
+    {
+        return 0.0f;
+    }
+    return std::min(1.0f, static_cast<float>(GetCoverHeightAgainst(gameContext, cellIdx, fromCellIdx)) / unitHeight);
+}
\ No newline at end of file
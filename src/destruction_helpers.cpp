@@ -1,9 +1,15 @@
 #include "destruction_helpers.h"
 #include "obstacle_helpers.h"
 #include "unit_helpers.h"
+#include "map_helpers.h"
+#include "vision_helpers.h"
+#include <optional>
 
 void sDestroyGameObjects(GameContext *gameContext)
 {
+    // Taken on the first destruction, so frames without any never wait for running path searches
+    std::optional<PathService::WorldWriteLock> worldLock;
+
     // Handle unit destruction
     bool didDestroyUnit = false;
     auto unitView = gameContext->registry.view<Unit>();
@@ -12,13 +18,26 @@ void sDestroyGameObjects(GameContext *gameContext)
         auto &unitComp = gameContext->registry.get<Unit>(entity);
         if (unitComp.currentHealth <= 0)
         {
+            if (!worldLock)
+            {
+                worldLock = gameContext->pathService.LockWorld();
+            }
             didDestroyUnit = true;
             if (entity == gameContext->selectedUnit)
             {
                 gameContext->selectedUnit = entt::null;
+                gameContext->selectedGroup.clear();
             }
-            gameContext->allUnits.erase(unitComp.cellIdx);
+            std::vector<entt::entity> &selectedGroup = gameContext->selectedGroup;
+            selectedGroup.erase(std::remove(selectedGroup.begin(), selectedGroup.end(), entity), selectedGroup.end());
+            Vector2i cellIdx = unitComp.cellIdx;
+            if (auto *viewshed = gameContext->registry.try_get<Viewshed>(entity))
+            {
+                ReleaseViewshed(gameContext, unitComp, *viewshed);
+            }
+            gameContext->mapGrid.SetUnit(cellIdx, entt::null);
             gameContext->registry.destroy(entity);
+            RefreshCellSummary(gameContext, cellIdx);
         }
     }
 
@@ -34,7 +53,11 @@ void sDestroyGameObjects(GameContext *gameContext)
         auto &obstacleComp = gameContext->registry.get<Obstacle>(entity);
         if (obstacleComp.isDestructible && obstacleComp.currentHealth <= 0)
         {
-            gameContext->allObstacles.erase(obstacleComp.cellIdx);
+            if (!worldLock)
+            {
+                worldLock = gameContext->pathService.LockWorld();
+            }
+            gameContext->mapGrid.SetObstacle(obstacleComp.cellIdx, entt::null);
             CreateObstacle(gameContext, "ground", obstacleComp.cellIdx);
             gameContext->registry.destroy(entity);
         }
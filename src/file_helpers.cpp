@@ -3,6 +3,17 @@
 #include <iostream>
 #include <stdexcept>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 std::vector<std::string> GetFileNamesInDirectory(const std::string &directoryPath)
 {
     std::vector<std::string> fileNames;
@@ -58,4 +69,87 @@ nlohmann::json LoadJsonFromFile(const std::string &filePath)
     }
 
     return jsonData;
+}
+
+MappedFile MapFileReadOnly(const std::string &filePath)
+{
+    MappedFile mappedFile;
+
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        throw std::ios_base::failure("Failed to open the file: " + filePath);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(fileHandle);
+        throw std::ios_base::failure("Failed to map empty or unreadable file: " + filePath);
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+    {
+        CloseHandle(fileHandle);
+        throw std::ios_base::failure("Failed to map the file: " + filePath);
+    }
+
+    const void *view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        throw std::ios_base::failure("Failed to map the file: " + filePath);
+    }
+
+    mappedFile.data = static_cast<const unsigned char *>(view);
+    mappedFile.size = static_cast<size_t>(fileSize.QuadPart);
+    mappedFile.fileHandle = fileHandle;
+    mappedFile.mappingHandle = mappingHandle;
+#else
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::ios_base::failure("Failed to open the file: " + filePath);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        throw std::ios_base::failure("Failed to map empty or unreadable file: " + filePath);
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file
+    if (view == MAP_FAILED)
+    {
+        throw std::ios_base::failure("Failed to map the file: " + filePath);
+    }
+
+    mappedFile.data = static_cast<const unsigned char *>(view);
+    mappedFile.size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    return mappedFile;
+}
+
+void UnmapFile(MappedFile &mappedFile)
+{
+    if (mappedFile.data == nullptr)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mappedFile.data);
+    CloseHandle(static_cast<HANDLE>(mappedFile.mappingHandle));
+    CloseHandle(static_cast<HANDLE>(mappedFile.fileHandle));
+#else
+    munmap(const_cast<unsigned char *>(mappedFile.data), mappedFile.size);
+#endif
+
+    mappedFile = MappedFile();
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "flow_field.h"
+
+// Room the routes of a group get around the box spanned by its units and the goal, so they can walk around obstacles
+static const int WINDOW_MARGIN = MapGrid::CHUNK_SIZE;
+
+// Dijkstra backwards from the goal under the rules of FindPath, over a window around the goal and sourceCellIdxs.
+// Stops as soon as every source cell has its final cost, so only the part of the field the group walks on is filled.
+void ComputeFlowField(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &goalCellIdx, const std::vector<Vector2i> &sourceCellIdxs, FlowField &field)
+{
+    field.goalCellIdx = goalCellIdx;
+    field.windowWidth = 0;
+    field.windowHeight = 0;
+    if (!mapGrid.InBounds(goalCellIdx))
+    {
+        field.costs.clear();
+        field.nextDirections.clear();
+        return;
+    }
+
+    Vector2i minCellIdx = goalCellIdx;
+    Vector2i maxCellIdx = goalCellIdx;
+    for (const Vector2i &sourceCellIdx : sourceCellIdxs)
+    {
+        minCellIdx = {std::min(minCellIdx.x, sourceCellIdx.x), std::min(minCellIdx.y, sourceCellIdx.y)};
+        maxCellIdx = {std::max(maxCellIdx.x, sourceCellIdx.x), std::max(maxCellIdx.y, sourceCellIdx.y)};
+    }
+    field.minCellIdx = {std::max(minCellIdx.x - WINDOW_MARGIN, 0), std::max(minCellIdx.y - WINDOW_MARGIN, 0)};
+    field.windowWidth = std::min(maxCellIdx.x + WINDOW_MARGIN, mapGrid.width - 1) - field.minCellIdx.x + 1;
+    field.windowHeight = std::min(maxCellIdx.y + WINDOW_MARGIN, mapGrid.height - 1) - field.minCellIdx.y + 1;
+    size_t windowArea = static_cast<size_t>(field.windowWidth) * field.windowHeight;
+    field.costs.assign(windowArea, -1);
+    field.nextDirections.assign(windowArea, FLOW_DIRECTION_NONE);
+
+    std::vector<uint8_t> isUnsettledSource(windowArea, 0);
+    int unsettledSourceCount = 0;
+    for (const Vector2i &sourceCellIdx : sourceCellIdxs)
+    {
+        int windowIdx = field.GetWindowIdx(sourceCellIdx);
+        if (windowIdx >= 0 && !isUnsettledSource[windowIdx])
+        {
+            isUnsettledSource[windowIdx] = 1;
+            unsettledSourceCount++;
+        }
+    }
+
+    std::vector<PathHeapNode> &openHeap = buffer.openHeap;
+    openHeap.clear();
+    field.costs[field.GetWindowIdx(goalCellIdx)] = 0;
+    openHeap.push_back({0, goalCellIdx.x, goalCellIdx.y});
+
+    while (!openHeap.empty() && unsettledSourceCount > 0)
+    {
+        std::pop_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+        PathHeapNode node = openHeap.back();
+        openHeap.pop_back();
+
+        int windowIdx = field.GetWindowIdx({node.x, node.y});
+        if (node.estimatedCost != field.costs[windowIdx])
+        {
+            continue; // stale duplicate of a cell that was since reached more cheaply
+        }
+        if (isUnsettledSource[windowIdx])
+        {
+            isUnsettledSource[windowIdx] = 0;
+            unsettledSourceCount--;
+        }
+
+        // Every cell that can step into this one in direction
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            Vector2i fromCellIdx = {node.x - COVER_DIRECTION_OFFSETS_X[direction], node.y - COVER_DIRECTION_OFFSETS_Y[direction]};
+            int fromWindowIdx = field.GetWindowIdx(fromCellIdx);
+            if (fromWindowIdx < 0)
+            {
+                continue;
+            }
+            int toIdx;
+            int stepSupplies = GetStepCostSupplies(mapGrid, moveRules, fromCellIdx, direction, toIdx);
+            if (stepSupplies < 0)
+            {
+                continue;
+            }
+
+            int64_t fromCost = node.estimatedCost + GetStepSearchCost(stepSupplies, direction);
+            if (field.costs[fromWindowIdx] >= 0 && field.costs[fromWindowIdx] <= fromCost)
+            {
+                continue;
+            }
+            field.costs[fromWindowIdx] = fromCost;
+            field.nextDirections[fromWindowIdx] = static_cast<uint8_t>(direction);
+
+            openHeap.push_back({fromCost, fromCellIdx.x, fromCellIdx.y});
+            std::push_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "los_helpers.h"
+#include "map_helpers.h"
+#include "math_helpers.h"
+
+#if defined(OPEN_STRATEGY_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+// Rays spanning fewer cells than this walk cell by cell straight away; the pyramid only pays off on longer ones
+static const int MAX_HEIGHT_SKIP_MIN_DISTANCE = 10;
+// Short corridor passes start from 4x4 blocks: chunk-sized ones would nearly always be descended into
+static const int SHORT_RAY_TOP_LEVEL = 2;
+
+// Conservative pass over the max-height pyramid: descends from chunk-sized blocks only into blocks whose highest cell
+// could reach the ray. Returns true when no cell between observer and target can block, with clearance set to a lower
+// bound of the exact value; false means the exact walk has to decide. The margin keeps rounding differences against
+// the exact walk from ever turning a blocked ray into a clear one.
+// With a radius (in cells) the ray is fattened into a corridor: every ray whose points stay within that Chebyshev
+// distance of this one at the same t, and share its heights, is clear too.
+static bool IsRayClearByMaxHeights(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2 &startWorldPos, const float &startHeight, const Vector2i &targetCellIdx, const Vector2 &endWorldPos, const float &endHeight, const float &radius, float &clearance)
+{
+    struct Block
+    {
+        int level;
+        int x;
+        int y;
+    };
+
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    float startX = startWorldPos.x / gameContext->cellWidth;
+    float startY = startWorldPos.y / gameContext->cellHeight;
+    float deltaX = endWorldPos.x / gameContext->cellWidth - startX;
+    float deltaY = endWorldPos.y / gameContext->cellHeight - startY;
+    float inverseDeltaX = 1.0f / deltaX;
+    float inverseDeltaY = 1.0f / deltaY;
+    int flipX = deltaX < 0.0f ? 1 : 0;
+    int flipY = deltaY < 0.0f ? 1 : 0;
+    float heightDelta = endHeight - startHeight;
+    float margin = 1e-3f * (1.0f + std::fabs(heightDelta));
+    // Nothing at or below the lower end of the ray can block it, whatever the rounding, so those blocks need no margin
+    float lowestRayHeight = std::min(startHeight, endHeight);
+
+    // The exact walk accumulates its step distances in floats and drifts off the true line on long rays; boxes are
+    // padded by more than that drift so no cell the walk would visit is ever clipped away
+    float padding = 1e-3f + 2e-5f * (std::fabs(deltaX) + std::fabs(deltaY)) + radius;
+
+    // Part of the segment inside the padded box [minX, maxX] x [minY, maxY] (cell units) as a t range; false if it misses
+    auto clipToBox = [&](const float &minX, const float &minY, const float &maxX, const float &maxY, float &tEnter, float &tExit)
+    {
+        tEnter = 0.0f;
+        tExit = 1.0f;
+        const float starts[2] = {startX, startY};
+        const float deltas[2] = {deltaX, deltaY};
+        const float inverseDeltas[2] = {inverseDeltaX, inverseDeltaY};
+        const float mins[2] = {minX - padding, minY - padding};
+        const float maxs[2] = {maxX + padding, maxY + padding};
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (deltas[axis] == 0.0f)
+            {
+                if (starts[axis] < mins[axis] || starts[axis] > maxs[axis])
+                {
+                    return false;
+                }
+                continue;
+            }
+            float t0 = (mins[axis] - starts[axis]) * inverseDeltas[axis];
+            float t1 = (maxs[axis] - starts[axis]) * inverseDeltas[axis];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+        }
+        return tEnter <= tExit;
+    };
+
+    // Descends into a block only when the ray may dip to its highest cell; false as soon as a cell might block
+    bool isLongRay = GetChebyshevDistance(observerCellIdx, targetCellIdx) >= MAX_HEIGHT_SKIP_MIN_DISTANCE;
+    const int topLevel = isLongRay ? MapGrid::MAX_HEIGHT_LEVEL_COUNT : SHORT_RAY_TOP_LEVEL;
+    Block stack[4 * MapGrid::MAX_HEIGHT_LEVEL_COUNT + 1];
+    // Hilly ground makes the pass descend everywhere and then fall back anyway; the budget caps what that can cost
+    int visitBudget = isLongRay ? GetChebyshevDistance(observerCellIdx, targetCellIdx) / 4 : std::numeric_limits<int>::max();
+    clearance = std::numeric_limits<float>::infinity();
+    auto isBlockClear = [&](const int &topBlockX, const int &topBlockY)
+    {
+        int stackSize = 0;
+        stack[stackSize++] = {topLevel, topBlockX, topBlockY};
+        while (stackSize > 0)
+        {
+            Block block = stack[--stackSize];
+            if (--visitBudget < 0)
+            {
+                return false;
+            }
+            if (block.x < 0 || block.y < 0 || block.x >= mapGrid.GetLevelWidth(block.level) || block.y >= mapGrid.GetLevelHeight(block.level))
+            {
+                continue;
+            }
+            if (block.level == 0 && ((block.x == observerCellIdx.x && block.y == observerCellIdx.y) || (block.x == targetCellIdx.x && block.y == targetCellIdx.y)))
+            {
+                continue;
+            }
+
+            float size = static_cast<float>(1 << block.level);
+            float tEnter, tExit;
+            if (!clipToBox(block.x * size, block.y * size, (block.x + 1) * size, (block.y + 1) * size, tEnter, tExit))
+            {
+                continue;
+            }
+
+            int blockMaxHeight = mapGrid.GetMaxHeight(block.level, block.x, block.y);
+            float rayHeight = std::min(startHeight + heightDelta * tEnter, startHeight + heightDelta * tExit);
+            float blockClearance = rayHeight - blockMaxHeight;
+            if (blockMaxHeight <= lowestRayHeight || blockClearance >= margin)
+            {
+                clearance = std::min(clearance, blockClearance);
+                continue;
+            }
+            if (block.level == 0)
+            {
+                return false;
+            }
+
+            // Pushed farthest first so the children nearest the observer are tried first
+            for (int child = 3; child >= 0; child--)
+            {
+                stack[stackSize++] = {block.level - 1, block.x * 2 + ((child & 1) ^ flipX), block.y * 2 + ((child >> 1) ^ flipY)};
+            }
+        }
+        return true;
+    };
+
+    // Top blocks row by row from the observer's side; every block the padded segment can touch in a row is tried and
+    // clipping drops the rest. Blockers usually sit near the ends of the ray, so a doomed pass gives up early.
+    float topSize = static_cast<float>(1 << topLevel);
+    int topRowMin = std::max(0, static_cast<int>(std::floor((std::min(startY, startY + deltaY) - padding) / topSize)));
+    int topRowMax = std::min(mapGrid.GetLevelHeight(topLevel) - 1, static_cast<int>(std::floor((std::max(startY, startY + deltaY) + padding) / topSize)));
+    for (int row = 0; row <= topRowMax - topRowMin; row++)
+    {
+        int topBlockY = flipY ? topRowMax - row : topRowMin + row;
+        float tEnter, tExit;
+        if (!clipToBox(-std::numeric_limits<float>::infinity(), topBlockY * topSize, std::numeric_limits<float>::infinity(), (topBlockY + 1) * topSize, tEnter, tExit))
+        {
+            continue;
+        }
+        float rowMinX = std::min(startX + deltaX * tEnter, startX + deltaX * tExit) - padding;
+        float rowMaxX = std::max(startX + deltaX * tEnter, startX + deltaX * tExit) + padding;
+        int topColMin = std::max(0, static_cast<int>(std::floor(rowMinX / topSize)));
+        int topColMax = std::min(mapGrid.GetLevelWidth(topLevel) - 1, static_cast<int>(std::floor(rowMaxX / topSize)));
+        for (int col = 0; col <= topColMax - topColMin; col++)
+        {
+            if (!isBlockClear(flipX ? topColMax - col : topColMin + col, topBlockY))
+            {
+                return false;
+            }
+        }
+    }
+
+    if (clearance == std::numeric_limits<float>::infinity())
+    {
+        clearance = 0.0f; // no intermediate cells
+    }
+    return true;
+}
+
+// Walks the ray once through the materialized height layer. Heights are extruded cells from z = 0 to the cell's
+// total height; a cell occludes when the ray dips below its top anywhere inside the cell's footprint. The
+// observer's own cell is skipped and reaching the target cell counts as LOS.
+LOSResult TraceElevationRay(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2 &startWorldPos, const float &startHeight, const Vector2i &targetCellIdx, const Vector2 &endWorldPos, const float &endHeight)
+{
+    LOSResult result;
+    if (GetChebyshevDistance(observerCellIdx, targetCellIdx) >= MAX_HEIGHT_SKIP_MIN_DISTANCE &&
+        IsRayClearByMaxHeights(gameContext, observerCellIdx, startWorldPos, startHeight, targetCellIdx, endWorldPos, endHeight, 0.0f, result.clearance))
+    {
+        return result;
+    }
+    result.clearance = std::numeric_limits<float>::infinity();
+
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    float heightDelta = endHeight - startHeight;
+    TraverseGridLine(startWorldPos, endWorldPos, gameContext->cellWidth, gameContext->cellHeight, false, [&](const Vector2i &cell, float tEnter, float tExit)
+                     {
+        if (cell == observerCellIdx)
+        {
+            return true;
+        }
+        if (cell == targetCellIdx)
+        {
+            return false;
+        }
+
+        int cellHeight = mapGrid.InBounds(cell) ? mapGrid.totalHeights[mapGrid.CellToIndex(cell)] : 0;
+        // The ray is linear in t, so its lowest point over the cell is at one of the two ends
+        float rayHeight = std::min(startHeight + heightDelta * tEnter, startHeight + heightDelta * tExit);
+        float clearance = rayHeight - cellHeight;
+        result.clearance = std::min(result.clearance, clearance);
+        if (clearance < 0.0f)
+        {
+            result.hasLOS = false;
+            result.blockingCell = cell;
+            return false;
+        }
+        return true; });
+
+    if (result.clearance == std::numeric_limits<float>::infinity())
+    {
+        result.clearance = 0.0f; // no intermediate cells
+    }
+    return result;
+}
+
+static Vector2 GetCellCenterWorldPos(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    Vector2 corner = MapToWorld(cellIdx, gameContext->cellWidth, gameContext->cellHeight);
+    return {corner.x + gameContext->cellWidth / 2.0f, corner.y + gameContext->cellHeight / 2.0f};
+}
+
+// Cell center to cell center, from the top of the observer's cell to the top of the target's cell
+LOSResult TraceElevationLOS(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx)
+{
+    // Adjacent cells always see each other
+    if (GetChebyshevDistance(observerCellIdx, targetCellIdx) <= 1)
+    {
+        return LOSResult();
+    }
+
+    if (!CheckCellInMapBounds(gameContext, observerCellIdx) || !CheckCellInMapBounds(gameContext, targetCellIdx))
+    {
+        LOSResult result;
+        result.hasLOS = false;
+        return result;
+    }
+
+    Vector2 observerCenter = GetCellCenterWorldPos(gameContext, observerCellIdx);
+    Vector2 targetCenter = GetCellCenterWorldPos(gameContext, targetCellIdx);
+    float observerHeight = static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, observerCellIdx));
+    float targetHeight = static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, targetCellIdx));
+
+    return TraceElevationRay(gameContext, observerCellIdx, observerCenter, observerHeight, targetCellIdx, targetCenter, targetHeight);
+}
+
+#if defined(OPEN_STRATEGY_AVX2)
+static bool CanUseAVX2LOSKernel()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#elif defined(_MSC_VER)
+    // AVX2 needs both the CPUID feature bit and OS support for saving the YMM registers
+    static const bool supported = []()
+    {
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 0);
+        if (cpuInfo[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(cpuInfo, 1);
+        bool osSavesYmm = (cpuInfo[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(cpuInfo, 7, 0);
+        return osSavesYmm && (cpuInfo[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+#endif
+
+// Same answers as TraceElevationLOS, for a ray that may start anywhere inside the observer's cell
+static bool HasElevationLOSForRay(const GameContext *gameContext, const LOSRay &ray)
+{
+    Vector2i observerCellIdx = {ray.observerX, ray.observerY};
+    Vector2i targetCellIdx = {ray.targetX, ray.targetY};
+    if (GetChebyshevDistance(observerCellIdx, targetCellIdx) <= 1)
+    {
+        return true;
+    }
+    if (!CheckCellInMapBounds(gameContext, observerCellIdx) || !CheckCellInMapBounds(gameContext, targetCellIdx))
+    {
+        return false;
+    }
+
+    float observerHeight = static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, observerCellIdx));
+    float targetHeight = static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, targetCellIdx));
+    return TraceElevationRay(gameContext, observerCellIdx, {ray.startWorldX, ray.startWorldY}, observerHeight, targetCellIdx, GetCellCenterWorldPos(gameContext, targetCellIdx), targetHeight).hasLOS;
+}
+
+static void HasElevationLOSRayBatch(const GameContext *gameContext, const LOSRay *rays, const int &count, uint8_t *outHasLOS)
+{
+#if defined(OPEN_STRATEGY_AVX2)
+    if (CanUseAVX2LOSKernel())
+    {
+        const MapGrid &mapGrid = gameContext->mapGrid;
+        LOSKernelGrid grid = {mapGrid.totalHeights.data(), mapGrid.width, mapGrid.height, mapGrid.chunksX, gameContext->cellWidth, gameContext->cellHeight};
+        HasElevationRayBatchAVX2(grid, rays, count, outHasLOS);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++)
+    {
+        outHasLOS[i] = HasElevationLOSForRay(gameContext, rays[i]);
+    }
+}
+
+// Sample 0 is the cell center, 1-4 are the corners pulled in by losCornerSampleInset so they stay inside the cell
+static LOSRay MakeLOSSampleRay(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const int &sampleIdx)
+{
+    Vector2 startWorldPos = GetCellCenterWorldPos(gameContext, observerCellIdx);
+    if (sampleIdx > 0)
+    {
+        float reach = 0.5f - gameContext->losCornerSampleInset;
+        float signX = (sampleIdx == 1 || sampleIdx == 4) ? -1.0f : 1.0f;
+        float signY = sampleIdx <= 2 ? -1.0f : 1.0f;
+        startWorldPos.x += signX * reach * gameContext->cellWidth;
+        startWorldPos.y += signY * reach * gameContext->cellHeight;
+    }
+    return {observerCellIdx.x, observerCellIdx.y, targetCellIdx.x, targetCellIdx.y, startWorldPos.x, startWorldPos.y};
+}
+
+// One fattened pass over the corridor all samples sweep: they share the center ray's heights and stay within the
+// corner reach of it. True proves every sample sees the target; the cells are in bounds and not adjacent.
+static bool AreAllLOSSamplesClear(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx)
+{
+    float clearance;
+    return IsRayClearByMaxHeights(gameContext, observerCellIdx, GetCellCenterWorldPos(gameContext, observerCellIdx), static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, observerCellIdx)),
+                                  targetCellIdx, GetCellCenterWorldPos(gameContext, targetCellIdx), static_cast<float>(GetTotalHeightForCellIdxUnchecked(gameContext, targetCellIdx)),
+                                  0.5f - gameContext->losCornerSampleInset, clearance);
+}
+
+MultiSampleLOSResult TraceMultiSampleLOS(const GameContext *gameContext, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const bool &stopAtFirstVisible)
+{
+    MultiSampleLOSResult result;
+    if (GetChebyshevDistance(observerCellIdx, targetCellIdx) <= 1)
+    {
+        result.visibleSampleCount = LOS_SAMPLE_COUNT;
+        return result;
+    }
+    if (!CheckCellInMapBounds(gameContext, observerCellIdx) || !CheckCellInMapBounds(gameContext, targetCellIdx))
+    {
+        return result;
+    }
+
+    if (stopAtFirstVisible)
+    {
+        // Center first: it is the likeliest to see the target and usually settles the query alone
+        LOSResult centerLOS = TraceElevationLOS(gameContext, observerCellIdx, targetCellIdx);
+        result.blockingCell = centerLOS.blockingCell;
+        for (int sampleIdx = 0; sampleIdx < LOS_SAMPLE_COUNT && result.visibleSampleCount == 0; sampleIdx++)
+        {
+            bool hasLOS = sampleIdx == 0 ? centerLOS.hasLOS : HasElevationLOSForRay(gameContext, MakeLOSSampleRay(gameContext, observerCellIdx, targetCellIdx, sampleIdx));
+            result.visibleSampleCount += hasLOS ? 1 : 0;
+        }
+        return result;
+    }
+
+    if (AreAllLOSSamplesClear(gameContext, observerCellIdx, targetCellIdx))
+    {
+        result.visibleSampleCount = LOS_SAMPLE_COUNT;
+        return result;
+    }
+
+    LOSRay rays[LOS_SAMPLE_COUNT];
+    for (int sampleIdx = 0; sampleIdx < LOS_SAMPLE_COUNT; sampleIdx++)
+    {
+        rays[sampleIdx] = MakeLOSSampleRay(gameContext, observerCellIdx, targetCellIdx, sampleIdx);
+    }
+
+    uint8_t hasLOS[LOS_SAMPLE_COUNT];
+    HasElevationLOSRayBatch(gameContext, rays, LOS_SAMPLE_COUNT, hasLOS);
+    for (int sampleIdx = 0; sampleIdx < LOS_SAMPLE_COUNT; sampleIdx++)
+    {
+        result.visibleSampleCount += hasLOS[sampleIdx];
+    }
+    if (!hasLOS[0])
+    {
+        result.blockingCell = TraceElevationLOS(gameContext, observerCellIdx, targetCellIdx).blockingCell;
+    }
+    return result;
+}
+
+void GetVisibleFractionBatch(const GameContext *gameContext, const LOSQuery *queries, const int &count, float *outVisibleFractions)
+{
+    // Most queries are settled by one corridor pass. The rest queue their samples next to each other, so they share
+    // kernel lanes and walk the same cells while those are in cache.
+    std::vector<LOSRay> rays;
+    std::vector<int> rayQueryIdxs;
+    for (int i = 0; i < count; i++)
+    {
+        Vector2i observerCellIdx = {queries[i].observerX, queries[i].observerY};
+        Vector2i targetCellIdx = {queries[i].targetX, queries[i].targetY};
+        if (GetChebyshevDistance(observerCellIdx, targetCellIdx) <= 1)
+        {
+            outVisibleFractions[i] = 1.0f;
+            continue;
+        }
+        if (!CheckCellInMapBounds(gameContext, observerCellIdx) || !CheckCellInMapBounds(gameContext, targetCellIdx))
+        {
+            outVisibleFractions[i] = 0.0f;
+            continue;
+        }
+        if (AreAllLOSSamplesClear(gameContext, observerCellIdx, targetCellIdx))
+        {
+            outVisibleFractions[i] = 1.0f;
+            continue;
+        }
+
+        outVisibleFractions[i] = 0.0f;
+        for (int sampleIdx = 0; sampleIdx < LOS_SAMPLE_COUNT; sampleIdx++)
+        {
+            rays.push_back(MakeLOSSampleRay(gameContext, observerCellIdx, targetCellIdx, sampleIdx));
+            rayQueryIdxs.push_back(i);
+        }
+    }
+
+    std::vector<uint8_t> hasLOS(rays.size());
+    HasElevationLOSRayBatch(gameContext, rays.data(), static_cast<int>(rays.size()), hasLOS.data());
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        outVisibleFractions[rayQueryIdxs[i]] += hasLOS[i] / static_cast<float>(LOS_SAMPLE_COUNT);
+    }
+}
\ No newline at end of file
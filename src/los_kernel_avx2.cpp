@@ -0,0 +1,259 @@
+#include "los_kernel.h"
+
+// Only compiled with real content when the build enables AVX2 for this file (see OPEN_STRATEGY_AVX2 in CMakeLists.txt)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include <cmath>
+#include <cstdlib>
+
+// Mirrors map_grid.h; kept local so this file stays free of the game headers
+static const int CHUNK_SHIFT = 5;
+static const int CHUNK_MASK = (1 << CHUNK_SHIFT) - 1;
+
+// Per-lane traversal state, laid out for aligned loads
+struct alignas(32) LaneSetup
+{
+    int cellX[8];
+    int cellY[8];
+    int stepX[8];
+    int stepY[8];
+    int observerX[8];
+    int observerY[8];
+    int targetX[8];
+    int targetY[8];
+    int remainingSteps[8];
+    int active[8];
+    int hasLOS[8];
+    float tEnter[8];
+    float tMaxX[8];
+    float tMaxY[8];
+    float tDeltaX[8];
+    float tDeltaY[8];
+    float startHeight[8];
+    float heightDelta[8];
+};
+
+// The same state held in registers while the lanes step
+struct LaneRegisters
+{
+    __m256i cellX, cellY, stepX, stepY, observerX, observerY, targetX, targetY, remainingSteps, active, hasLOS;
+    __m256 tEnter, tMaxX, tMaxY, tDeltaX, tDeltaY, startHeight, heightDelta;
+};
+
+static __m256i LoadInts(const int *values)
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(values));
+}
+
+static void StoreInts(int *values, const __m256i &vector)
+{
+    _mm256_store_si256(reinterpret_cast<__m256i *>(values), vector);
+}
+
+static void LoadLanes(const LaneSetup &setup, LaneRegisters &regs)
+{
+    regs.cellX = LoadInts(setup.cellX);
+    regs.cellY = LoadInts(setup.cellY);
+    regs.stepX = LoadInts(setup.stepX);
+    regs.stepY = LoadInts(setup.stepY);
+    regs.observerX = LoadInts(setup.observerX);
+    regs.observerY = LoadInts(setup.observerY);
+    regs.targetX = LoadInts(setup.targetX);
+    regs.targetY = LoadInts(setup.targetY);
+    regs.remainingSteps = LoadInts(setup.remainingSteps);
+    regs.active = LoadInts(setup.active);
+    regs.hasLOS = LoadInts(setup.hasLOS);
+    regs.tEnter = _mm256_load_ps(setup.tEnter);
+    regs.tMaxX = _mm256_load_ps(setup.tMaxX);
+    regs.tMaxY = _mm256_load_ps(setup.tMaxY);
+    regs.tDeltaX = _mm256_load_ps(setup.tDeltaX);
+    regs.tDeltaY = _mm256_load_ps(setup.tDeltaY);
+    regs.startHeight = _mm256_load_ps(setup.startHeight);
+    regs.heightDelta = _mm256_load_ps(setup.heightDelta);
+}
+
+static void StoreLanes(const LaneRegisters &regs, LaneSetup &setup)
+{
+    StoreInts(setup.cellX, regs.cellX);
+    StoreInts(setup.cellY, regs.cellY);
+    StoreInts(setup.stepX, regs.stepX);
+    StoreInts(setup.stepY, regs.stepY);
+    StoreInts(setup.observerX, regs.observerX);
+    StoreInts(setup.observerY, regs.observerY);
+    StoreInts(setup.targetX, regs.targetX);
+    StoreInts(setup.targetY, regs.targetY);
+    StoreInts(setup.remainingSteps, regs.remainingSteps);
+    StoreInts(setup.active, regs.active);
+    StoreInts(setup.hasLOS, regs.hasLOS);
+    _mm256_store_ps(setup.tEnter, regs.tEnter);
+    _mm256_store_ps(setup.tMaxX, regs.tMaxX);
+    _mm256_store_ps(setup.tMaxY, regs.tMaxY);
+    _mm256_store_ps(setup.tDeltaX, regs.tDeltaX);
+    _mm256_store_ps(setup.tDeltaY, regs.tDeltaY);
+    _mm256_store_ps(setup.startHeight, regs.startHeight);
+    _mm256_store_ps(setup.heightDelta, regs.heightDelta);
+}
+
+static int GetHeight(const LOSKernelGrid &grid, const int &x, const int &y)
+{
+    int chunkIdx = (y >> CHUNK_SHIFT) * grid.chunksX + (x >> CHUNK_SHIFT);
+    int localIdx = ((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK);
+    return grid.totalHeights[(chunkIdx << (CHUNK_SHIFT * 2)) | localIdx];
+}
+
+// Same arithmetic as TraceElevationRay / TraverseGridLine so both paths agree bit for bit. Returns false when the
+// query is answered without tracing (adjacent or out of bounds); hasLOS then already holds the answer.
+static bool SetupLane(const LOSKernelGrid &grid, const LOSRay &query, LaneSetup &setup, const int &lane)
+{
+    const float infinity = INFINITY;
+    int distX = std::abs(query.targetX - query.observerX);
+    int distY = std::abs(query.targetY - query.observerY);
+    bool inBounds = query.observerX >= 0 && query.observerY >= 0 && query.observerX < grid.width && query.observerY < grid.height &&
+                    query.targetX >= 0 && query.targetY >= 0 && query.targetX < grid.width && query.targetY < grid.height;
+
+    setup.active[lane] = 0;
+    setup.hasLOS[lane] = distX <= 1 && distY <= 1 ? -1 : 0;
+    if ((distX <= 1 && distY <= 1) || !inBounds)
+    {
+        return false;
+    }
+
+    float halfCellWidth = grid.cellWidth / 2.0f;
+    float halfCellHeight = grid.cellHeight / 2.0f;
+    float startX = query.startWorldX / grid.cellWidth;
+    float startY = query.startWorldY / grid.cellHeight;
+    float deltaX = (static_cast<float>(query.targetX * grid.cellWidth) + halfCellWidth) / grid.cellWidth - startX;
+    float deltaY = (static_cast<float>(query.targetY * grid.cellHeight) + halfCellHeight) / grid.cellHeight - startY;
+
+    int stepX = deltaX > 0 ? 1 : (deltaX < 0 ? -1 : 0);
+    int stepY = deltaY > 0 ? 1 : (deltaY < 0 ? -1 : 0);
+    float tDeltaX = stepX != 0 ? 1.0f / std::fabs(deltaX) : infinity;
+    float tDeltaY = stepY != 0 ? 1.0f / std::fabs(deltaY) : infinity;
+
+    setup.active[lane] = -1;
+    setup.hasLOS[lane] = -1;
+    setup.cellX[lane] = query.observerX;
+    setup.cellY[lane] = query.observerY;
+    setup.stepX[lane] = stepX;
+    setup.stepY[lane] = stepY;
+    setup.observerX[lane] = query.observerX;
+    setup.observerY[lane] = query.observerY;
+    setup.targetX[lane] = query.targetX;
+    setup.targetY[lane] = query.targetY;
+    setup.remainingSteps[lane] = distX + distY;
+    setup.tEnter[lane] = 0.0f;
+    setup.tDeltaX[lane] = tDeltaX;
+    setup.tDeltaY[lane] = tDeltaY;
+    setup.tMaxX[lane] = stepX > 0 ? (query.observerX + 1 - startX) * tDeltaX : (stepX < 0 ? (startX - query.observerX) * tDeltaX : infinity);
+    setup.tMaxY[lane] = stepY > 0 ? (query.observerY + 1 - startY) * tDeltaY : (stepY < 0 ? (startY - query.observerY) * tDeltaY : infinity);
+    setup.startHeight[lane] = static_cast<float>(GetHeight(grid, query.observerX, query.observerY));
+    setup.heightDelta[lane] = static_cast<float>(GetHeight(grid, query.targetX, query.targetY)) - setup.startHeight[lane];
+    return true;
+}
+
+// Advances every active lane by one cell: tests the cell it is in, then steps to the next one. A lane drops out
+// when it reaches its target, finds an occluder or runs out of steps.
+static void StepLanes(const LOSKernelGrid &grid, LaneRegisters &regs)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i allOnes = _mm256_set1_epi32(-1);
+    const __m256i chunkMask = _mm256_set1_epi32(CHUNK_MASK);
+
+    __m256 tExit = _mm256_min_ps(_mm256_min_ps(regs.tMaxX, regs.tMaxY), _mm256_set1_ps(1.0f));
+
+    __m256i isObserver = _mm256_and_si256(_mm256_cmpeq_epi32(regs.cellX, regs.observerX), _mm256_cmpeq_epi32(regs.cellY, regs.observerY));
+    __m256i isTarget = _mm256_and_si256(_mm256_cmpeq_epi32(regs.cellX, regs.targetX), _mm256_cmpeq_epi32(regs.cellY, regs.targetY));
+    __m256i inBounds = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zero, regs.cellX), _mm256_cmpgt_epi32(zero, regs.cellY)),
+                                           _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(grid.width), regs.cellX), _mm256_cmpgt_epi32(_mm256_set1_epi32(grid.height), regs.cellY)));
+    __m256i testLanes = _mm256_andnot_si256(_mm256_or_si256(isObserver, isTarget), _mm256_and_si256(regs.active, inBounds));
+
+    // Gather the cell heights of the lanes under test through the chunked index; out of bounds cells read as 0
+    __m256i chunkIdx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(regs.cellY, CHUNK_SHIFT), _mm256_set1_epi32(grid.chunksX)), _mm256_srai_epi32(regs.cellX, CHUNK_SHIFT));
+    __m256i localIdx = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(regs.cellY, chunkMask), CHUNK_SHIFT), _mm256_and_si256(regs.cellX, chunkMask));
+    __m256i idx = _mm256_or_si256(_mm256_slli_epi32(chunkIdx, CHUNK_SHIFT * 2), localIdx);
+    __m256i cellHeight = _mm256_mask_i32gather_epi32(zero, grid.totalHeights, idx, testLanes, 4);
+
+    __m256 rayHeight = _mm256_min_ps(_mm256_add_ps(regs.startHeight, _mm256_mul_ps(regs.heightDelta, regs.tEnter)),
+                                     _mm256_add_ps(regs.startHeight, _mm256_mul_ps(regs.heightDelta, tExit)));
+    __m256i blocked = _mm256_and_si256(testLanes, _mm256_castps_si256(_mm256_cmp_ps(rayHeight, _mm256_cvtepi32_ps(cellHeight), _CMP_LT_OQ)));
+
+    regs.hasLOS = _mm256_andnot_si256(blocked, regs.hasLOS);
+    __m256i outOfSteps = _mm256_cmpgt_epi32(_mm256_set1_epi32(1), regs.remainingSteps);
+    regs.active = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(blocked, isTarget), outOfSteps), regs.active);
+    regs.remainingSteps = _mm256_sub_epi32(regs.remainingSteps, _mm256_set1_epi32(1));
+
+    // Step along x, y, or both when the ray passes exactly through a corner
+    __m256 xFirst = _mm256_cmp_ps(regs.tMaxX, regs.tMaxY, _CMP_LT_OQ);
+    __m256 yFirst = _mm256_cmp_ps(regs.tMaxY, regs.tMaxX, _CMP_LT_OQ);
+    __m256i moveX = _mm256_xor_si256(_mm256_castps_si256(yFirst), allOnes);
+    __m256i moveY = _mm256_xor_si256(_mm256_castps_si256(xFirst), allOnes);
+
+    regs.tEnter = _mm256_blendv_ps(regs.tMaxX, regs.tMaxY, yFirst);
+    regs.cellX = _mm256_add_epi32(regs.cellX, _mm256_and_si256(regs.stepX, moveX));
+    regs.cellY = _mm256_add_epi32(regs.cellY, _mm256_and_si256(regs.stepY, moveY));
+    regs.tMaxX = _mm256_blendv_ps(regs.tMaxX, _mm256_add_ps(regs.tMaxX, regs.tDeltaX), _mm256_castsi256_ps(moveX));
+    regs.tMaxY = _mm256_blendv_ps(regs.tMaxY, _mm256_add_ps(regs.tMaxY, regs.tDeltaY), _mm256_castsi256_ps(moveY));
+    regs.remainingSteps = _mm256_add_epi32(regs.remainingSteps, _mm256_and_si256(moveX, moveY)); // diagonal steps cost one extra
+}
+
+// Eight rays walk their cells in lockstep. Whenever lanes finish, their results are written out and the lanes are
+// refilled from the ray list, so short and long rays mix without idling the vector.
+void HasElevationRayBatchAVX2(const LOSKernelGrid &grid, const LOSRay *rays, const int &count, uint8_t *outHasLOS)
+{
+    LaneSetup setup;
+    LaneRegisters regs;
+    int laneQuery[8];
+    int nextQuery = 0;
+
+    auto refillLane = [&](const int &lane)
+    {
+        laneQuery[lane] = -1;
+        setup.active[lane] = 0;
+        while (nextQuery < count)
+        {
+            int queryIdx = nextQuery++;
+            if (SetupLane(grid, rays[queryIdx], setup, lane))
+            {
+                laneQuery[lane] = queryIdx;
+                return;
+            }
+            outHasLOS[queryIdx] = setup.hasLOS[lane] != 0;
+        }
+    };
+
+    for (int lane = 0; lane < 8; lane++)
+    {
+        refillLane(lane);
+    }
+    LoadLanes(setup, regs);
+
+    int pendingLanes = 0;
+    for (int lane = 0; lane < 8; lane++)
+    {
+        pendingLanes |= laneQuery[lane] >= 0 ? 1 << lane : 0;
+    }
+
+    while (pendingLanes != 0)
+    {
+        StepLanes(grid, regs);
+
+        int finishedLanes = pendingLanes & ~_mm256_movemask_ps(_mm256_castsi256_ps(regs.active));
+        if (finishedLanes == 0)
+        {
+            continue;
+        }
+
+        StoreLanes(regs, setup);
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if (finishedLanes & (1 << lane))
+            {
+                outHasLOS[laneQuery[lane]] = setup.hasLOS[lane] != 0;
+                refillLane(lane);
+                pendingLanes = laneQuery[lane] >= 0 ? pendingLanes | (1 << lane) : pendingLanes & ~(1 << lane);
+            }
+        }
+        LoadLanes(setup, regs);
+    }
+}
+#endif
\ No newline at end of file
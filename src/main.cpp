@@ -33,6 +33,7 @@ int main()
 	while (!WindowShouldClose()) // run the loop untill the user presses ESCAPE or presses the Close button on the window
 	{
 		// update
+		gameContext.pathService.Poll();
 		sCameraKeyInput(&gameContext);
 		sUnitSelection(&gameContext);
 		sCycleSelectedAbility(&gameContext);
@@ -3,56 +3,232 @@
 #include "math_helpers.h"
 #include "obstacle_helpers.h"
 #include "unit_helpers.h"
+#include "osmap_helpers.h"
+#include "map_json_helpers.h"
+
+static bool UpdateCellSummary(GameContext *gameContext, const Vector2i &cellIdx);
 
 void BuildMap(GameContext *gameContext, const std::string &mapName)
 {
-    nlohmann::json mapData = LoadJsonFromFile("maps/" + mapName);
-    nlohmann::json cellData = mapData["cell_data"];
+    if (std::filesystem::path(mapName).extension() == ".osmap")
+    {
+        BuildMapFromOsmap(gameContext, "maps/" + mapName, mapName);
+        return;
+    }
+    BuildMapFromJson(gameContext, mapName);
+}
+
+void BuildMapFromJson(GameContext *gameContext, const std::string &mapName)
+{
+    JsonMapCells mapCells = LoadJsonMapCells("maps/" + mapName);
 
     gameContext->currentMap = mapName;
-    gameContext->mapWidth = mapData["meta"]["map_dimensions"]["map_width"];
-    gameContext->mapHeight = mapData["meta"]["map_dimensions"]["map_height"];
+    gameContext->mapWidth = mapCells.mapWidth;
+    gameContext->mapHeight = mapCells.mapHeight;
+
+    // Resolve records in parallel, then scatter serially so duplicate cell keys cannot race
+    std::vector<int> recordTemplateIds(mapCells.cells.size(), -1);
+    std::atomic<int> unresolvedCount{0};
+    gameContext->threadPool.ParallelFor(static_cast<int>(mapCells.cells.size()), 4096, [&](int begin, int end)
+                                        {
+        int unresolved = 0;
+        for (int i = begin; i < end; i++)
+        {
+            const MapCellRecord &cell = mapCells.cells[i];
+            recordTemplateIds[i] = gameContext->GetObstacleTemplateIdByAtlasCoords(cell.atlasId, {cell.atlasX, cell.atlasY});
+            unresolved += recordTemplateIds[i] < 0;
+        }
+        unresolvedCount += unresolved; });
+
+    if (unresolvedCount > 0)
+    {
+        std::cerr << unresolvedCount << " cells in " << mapName << " have no matching obstacle template" << std::endl;
+    }
 
-    for (auto it = cellData.begin(); it != cellData.end(); ++it)
+    std::vector<int> templateIds(static_cast<size_t>(gameContext->mapWidth) * gameContext->mapHeight, -1);
+    for (size_t i = 0; i < mapCells.cells.size(); i++)
     {
-        const std::string &key = it.key();
-        Vector2 cellIdxVector2 = Vector2StringToVector2(key);
-        Vector2i cellIdxVector2i = Vector2ToVector2i(cellIdxVector2);
-        const nlohmann::json &value = it.value();
-
-        std::string atlasCoordsString = value["cell_atlas_coords"];
-        Vector2 atlasCoords = Vector2StringToVector2(atlasCoordsString);
-        int atlasId = value["cell_source_id"];
-        nlohmann::json templateData = gameContext->GetObstacleTemplateByAtlasCoords(atlasId, atlasCoords);
-        std::string type = templateData["type"];
-        CreateObstacle(gameContext, type, cellIdxVector2i);
+        const MapCellRecord &cell = mapCells.cells[i];
+        if (cell.cellX < gameContext->mapWidth && cell.cellY < gameContext->mapHeight)
+        {
+            templateIds[static_cast<size_t>(cell.cellY) * gameContext->mapWidth + cell.cellX] = recordTemplateIds[i];
+        }
     }
 
-    int running_height = 0;
-    for (int y = 1; y < gameContext->mapHeight - 1; y++)
+    BuildMapFromTemplateIds(gameContext, templateIds);
+}
+
+// Splits [0, rowCount) into bandCount contiguous row bands
+static int GetBandStartRow(const int &rowCount, const int &bandCount, const int &band)
+{
+    return static_cast<int>(static_cast<long long>(rowCount) * band / bandCount);
+}
+
+void BuildMapFromTemplateIds(GameContext *gameContext, const std::vector<int> &templateIds)
+{
+    entt::registry &registry = gameContext->registry;
+    MapGrid &mapGrid = gameContext->mapGrid;
+    int mapWidth = gameContext->mapWidth;
+    int mapHeight = gameContext->mapHeight;
+    mapGrid.Resize(mapWidth, mapHeight);
+
+    // Count obstacles per row band so every band knows where its slice of the entity range starts
+    int bandCount = std::max(1, std::min(mapHeight, gameContext->threadPool.GetThreadCount() * 4));
+    std::vector<int> bandObstacleOffsets(bandCount + 1, 0);
+    gameContext->threadPool.ParallelFor(bandCount, 1, [&](int beginBand, int endBand)
+                                        {
+        for (int band = beginBand; band < endBand; band++)
+        {
+            int obstacleCount = 0;
+            size_t bandBegin = static_cast<size_t>(GetBandStartRow(mapHeight, bandCount, band)) * mapWidth;
+            size_t bandEnd = static_cast<size_t>(GetBandStartRow(mapHeight, bandCount, band + 1)) * mapWidth;
+            for (size_t i = bandBegin; i < bandEnd; i++)
+            {
+                obstacleCount += templateIds[i] >= 0;
+            }
+            bandObstacleOffsets[band + 1] = obstacleCount;
+        } });
+    for (int band = 0; band < bandCount; band++)
     {
-        for (int x = 1; x < gameContext->mapWidth - 1; x++)
+        bandObstacleOffsets[band + 1] += bandObstacleOffsets[band];
+    }
+    int obstacleCount = bandObstacleOffsets[bandCount];
+
+    // Bulk create: one reservation and one range create/insert instead of a registry call per cell
+    registry.storage<entt::entity>().reserve(registry.storage<entt::entity>().size() + obstacleCount);
+    registry.storage<Obstacle>().reserve(registry.storage<Obstacle>().size() + obstacleCount);
+    std::vector<entt::entity> obstacleEntities(obstacleCount);
+    registry.create(obstacleEntities.begin(), obstacleEntities.end());
+
+    std::vector<Obstacle> obstacles(obstacleCount);
+    gameContext->threadPool.ParallelFor(bandCount, 1, [&](int beginBand, int endBand)
+                                        {
+        for (int band = beginBand; band < endBand; band++)
         {
-            Vector2i mapPosition = {x, y};
-            auto &obstacle = gameContext->registry.get<Obstacle>(gameContext->allObstacles[mapPosition]);
-            std::string type = obstacle.type;
-            nlohmann::json obstacleTemplate = gameContext->obstacleTemplates[type];
-            bool incrementTerrainHeight = obstacleTemplate["increment_terrain_height"];
-            bool decrementTerrainHeight = obstacleTemplate["decrement_terrain_height"];
-            bool continueTerrainHeight = obstacleTemplate["continue_terrain_height"];
-            if (incrementTerrainHeight)
+            int obstacleIdx = bandObstacleOffsets[band];
+            for (int y = GetBandStartRow(mapHeight, bandCount, band); y < GetBandStartRow(mapHeight, bandCount, band + 1); y++)
             {
-                running_height++;
+                for (int x = 0; x < mapWidth; x++)
+                {
+                    int templateId = templateIds[static_cast<size_t>(y) * mapWidth + x];
+                    if (templateId < 0)
+                    {
+                        continue;
+                    }
+                    obstacles[obstacleIdx] = gameContext->compiledObstacleTemplates[templateId].prototype;
+                    obstacles[obstacleIdx].cellIdx = {x, y};
+                    mapGrid.obstacles[mapGrid.CellToIndex({x, y})] = obstacleEntities[obstacleIdx];
+                    obstacleIdx++;
+                }
             }
+        } });
+    registry.insert<Obstacle>(obstacleEntities.begin(), obstacleEntities.end(), obstacles.begin());
+
+    ComputeTerrainLevels(gameContext, templateIds);
+}
+
+// Assigns terrain levels from the cliff obstacles and refreshes every cell summary. The levels are one running
+// height carried across the interior cells in row-major order, computed as a two pass scan over row bands.
+void ComputeTerrainLevels(GameContext *gameContext, const std::vector<int> &templateIds)
+{
+    MapGrid &mapGrid = gameContext->mapGrid;
+    int mapWidth = gameContext->mapWidth;
+    int mapHeight = gameContext->mapHeight;
 
-            gameContext->terrainLevels[mapPosition] = running_height;
+    if (mapWidth > 2 && mapHeight > 2)
+    {
+        const uint8_t STEP_INCREMENT = 1 << 0;
+        const uint8_t STEP_DECREMENT = 1 << 1;
+        std::vector<uint8_t> stepsByTemplate;
+        for (const ObstacleTemplate &obstacleTemplate : gameContext->compiledObstacleTemplates)
+        {
+            stepsByTemplate.push_back((obstacleTemplate.incrementTerrainHeight ? STEP_INCREMENT : 0) | (obstacleTemplate.decrementTerrainHeight ? STEP_DECREMENT : 0));
+        }
 
-            if (decrementTerrainHeight)
+        auto getSteps = [&](const int &x, const int &y) -> uint8_t
+        {
+            int templateId = templateIds[static_cast<size_t>(y) * mapWidth + x];
+            return templateId >= 0 ? stepsByTemplate[templateId] : 0;
+        };
+
+        int interiorRows = mapHeight - 2;
+        int bandCount = std::max(1, std::min(interiorRows, gameContext->threadPool.GetThreadCount() * 4));
+        std::vector<int> bandStartHeights(bandCount + 1, 0);
+
+        // Pass 1: net height change of each band
+        gameContext->threadPool.ParallelFor(bandCount, 1, [&](int beginBand, int endBand)
+                                            {
+            for (int band = beginBand; band < endBand; band++)
             {
-                running_height--;
-            }
+                int delta = 0;
+                for (int y = 1 + GetBandStartRow(interiorRows, bandCount, band); y < 1 + GetBandStartRow(interiorRows, bandCount, band + 1); y++)
+                {
+                    for (int x = 1; x < mapWidth - 1; x++)
+                    {
+                        uint8_t steps = getSteps(x, y);
+                        delta += ((steps & STEP_INCREMENT) ? 1 : 0) - ((steps & STEP_DECREMENT) ? 1 : 0);
+                    }
+                }
+                bandStartHeights[band + 1] = delta;
+            } });
+        for (int band = 0; band < bandCount; band++)
+        {
+            bandStartHeights[band + 1] += bandStartHeights[band];
         }
+
+        // Pass 2: replay each band from its starting height
+        gameContext->threadPool.ParallelFor(bandCount, 1, [&](int beginBand, int endBand)
+                                            {
+            for (int band = beginBand; band < endBand; band++)
+            {
+                int running_height = bandStartHeights[band];
+                for (int y = 1 + GetBandStartRow(interiorRows, bandCount, band); y < 1 + GetBandStartRow(interiorRows, bandCount, band + 1); y++)
+                {
+                    for (int x = 1; x < mapWidth - 1; x++)
+                    {
+                        uint8_t steps = getSteps(x, y);
+                        if (steps & STEP_INCREMENT)
+                        {
+                            running_height++;
+                        }
+
+                        mapGrid.terrainLevels[mapGrid.CellToIndex({x, y})] = running_height;
+
+                        if (steps & STEP_DECREMENT)
+                        {
+                            running_height--;
+                        }
+                    }
+                }
+            } });
     }
+
+    // Make sure the pools exist before reading them from several threads
+    gameContext->registry.storage<Unit>();
+    gameContext->registry.storage<Obstacle>();
+    gameContext->threadPool.ParallelFor(mapHeight, 16, [&](int beginRow, int endRow)
+                                        {
+        for (int y = beginRow; y < endRow; y++)
+        {
+            for (int x = 0; x < mapWidth; x++)
+            {
+                UpdateCellSummary(gameContext, {x, y});
+            }
+        } });
+    // The rows above skip per-cell change tracking so the threads never share a chunk stamp
+    mapGrid.MarkAllChanged();
+    mapGrid.RebuildMaxHeightPyramid();
+
+    // Cover reads the neighbours' heights, so it can only be derived once every summary is in place
+    gameContext->threadPool.ParallelFor(mapHeight, 16, [&](int beginRow, int endRow)
+                                        {
+        for (int y = beginRow; y < endRow; y++)
+        {
+            for (int x = 0; x < mapWidth; x++)
+            {
+                mapGrid.UpdateCover({x, y});
+            }
+        } });
 }
 
 bool CheckMouseInMapBounds(GameContext *gameContext)
@@ -61,6 +237,11 @@ bool CheckMouseInMapBounds(GameContext *gameContext)
     return CheckCollisionPointRec(GetScreenToWorld2D(GetMousePosition(), gameContext->camera), mapRect);
 }
 
+bool CheckCellInMapBounds(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    return cellIdx.x >= 0 && cellIdx.y >= 0 && cellIdx.x < gameContext->mapWidth && cellIdx.y < gameContext->mapHeight;
+}
+
 void Startup(GameContext *gameContext)
 {
     std::string configSelectedMap = gameContext->gameSetup["mode_config"]["selected_map"];
@@ -72,7 +253,25 @@ void Startup(GameContext *gameContext)
 
         std::string mapName = gameContext->gameSetup["mode_config"]["selected_map"];
         // nlohmann::json mapData = LoadJsonFromFile("maps/" + mapName + ".json"); TODO use this one once .json is stripped out of incoming mapName
-        BuildMap(gameContext, mapName);
+        std::string compiledMapPath = GetCompiledMapPath(mapName);
+        bool isMapBuilt = false;
+        if (!compiledMapPath.empty())
+        {
+            try
+            {
+                BuildMapFromOsmap(gameContext, compiledMapPath, mapName);
+                isMapBuilt = true;
+            }
+            catch (const std::exception &e)
+            {
+                // Fall back to loading the JSON map directly
+                std::cerr << "Error loading compiled map: " << e.what() << "\n";
+            }
+        }
+        if (!isMapBuilt)
+        {
+            BuildMap(gameContext, mapName);
+        }
         CreateUnit(gameContext, "rifleman", {2, 2}, Teams::TEAM_BLUE);
         CreateUnit(gameContext, "rifleman", {4, 2}, Teams::TEAM_RED);
 
@@ -96,243 +295,208 @@ void Startup(GameContext *gameContext)
 // Extrusion-based Line-of-Sight
 ////////////////////////////////
 
-int GetTerrainLevelForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+int GetUnitStanceHeight(const Unit &unitComp)
 {
-    if (!CheckMouseInMapBounds(gameContext))
-    {
-        return 0;
-    }
-    return gameContext->terrainLevels[cellIdx];
-}
-
-int GetTerrainHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
-{
-    if (!CheckMouseInMapBounds(gameContext))
-    {
-        return 0;
-    }
-    return gameContext->terrainLevels[cellIdx] * gameContext->cliffIntrinsicHeight;
-}
-
-int GetUnitIntrinsicHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
-{
-    if (!CheckMouseInMapBounds(gameContext) || gameContext->allUnits.find(cellIdx) == gameContext->allUnits.end())
-    {
-        return 0;
-    }
-
-    entt::entity unitEntity = gameContext->allUnits[cellIdx];
-    auto &unitComp = gameContext->registry.get<Unit>(unitEntity);
     switch (unitComp.stance)
     {
     case Stances::CROUCHED:
         return unitComp.crouchHeight;
-        break;
     case Stances::STANDING:
         return unitComp.intrinsicHeight;
-        break;
     case Stances::PRONE:
         return unitComp.proneHeight;
-        break;
     case Stances::NONE:
         return unitComp.intrinsicHeight;
-        break;
     default:
         std::cout << "Stance not handled by switch" << std::endl;
+        return unitComp.intrinsicHeight;
     }
 }
 
-int GetTopMostObstacleIntrinsicHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+// Recomputes the materialized heights of one in-bounds cell; returns true when its total height changed
+static bool UpdateCellSummary(GameContext *gameContext, const Vector2i &cellIdx)
 {
-    if (!CheckMouseInMapBounds(gameContext) || gameContext->allObstacles.find(cellIdx) == gameContext->allObstacles.end())
+    MapGrid &mapGrid = gameContext->mapGrid;
+    int idx = mapGrid.CellToIndex(cellIdx);
+    entt::entity unitEntity = mapGrid.units[idx];
+    entt::entity obstacleEntity = mapGrid.obstacles[idx];
+    const Unit *unitComp = unitEntity != entt::null ? &gameContext->registry.get<Unit>(unitEntity) : nullptr;
+    const Obstacle *obstacleComp = obstacleEntity != entt::null ? &gameContext->registry.get<Obstacle>(obstacleEntity) : nullptr;
+
+    int terrainHeight = mapGrid.terrainLevels[idx] * gameContext->cliffIntrinsicHeight;
+    int unitIntrinsicHeight = unitComp ? GetUnitStanceHeight(*unitComp) : 0;
+    int obstacleIntrinsicHeight = obstacleComp ? obstacleComp->intrinsicHeight : 0;
+
+    int obstacleTopHeight = 0;
+    if (obstacleComp)
     {
-        return 0;
+        // Cliffs and walls are already accounted for by the terrain height
+        bool isCliffOrWall = obstacleComp->displayName == "cliff" || obstacleComp->displayName == "wall";
+        obstacleTopHeight = isCliffOrWall ? terrainHeight : terrainHeight + obstacleIntrinsicHeight;
     }
 
-    entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
-    auto &obstacleComp = gameContext->registry.get<Obstacle>(obstacleEntity);
-    return obstacleComp.intrinsicHeight;
-}
-
-int GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
-{
-    if (!CheckMouseInMapBounds(gameContext) || gameContext->allObstacles.find(cellIdx) == gameContext->allObstacles.end())
+    int unitTopHeight = 0;
+    if (unitComp)
     {
-        return 0;
+        unitTopHeight = (obstacleComp && obstacleComp->unitStandsOnTop) ? unitIntrinsicHeight + obstacleTopHeight : terrainHeight + unitIntrinsicHeight;
     }
 
-    entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
-    auto &obstacleComp = gameContext->registry.get<Obstacle>(obstacleEntity);
-
-    int terrainLevel = GetTerrainLevelForCellIdx(gameContext, cellIdx);
-    int terrainHeight = GetTerrainHeightForCellIdx(gameContext, cellIdx);
-    if (obstacleComp.displayName == "cliff" || obstacleComp.displayName == "wall")
+    uint8_t flags = CELL_FLAG_NONE;
+    if (obstacleComp && obstacleComp->displayName == "cliff")
+    {
+        flags |= CELL_FLAG_CLIFF;
+    }
+    if (unitComp && unitComp->stopsProjectile)
     {
-        return terrainHeight;
+        flags |= CELL_FLAG_UNIT_STOPS_PROJECTILE;
+    }
+    if (obstacleComp && obstacleComp->stopsProjectile)
+    {
+        flags |= CELL_FLAG_OBSTACLE_STOPS_PROJECTILE;
     }
 
-    // If there is an obstacle other than cliff or wall
-    return terrainHeight + GetTopMostObstacleIntrinsicHeightForCellIdx(gameContext, cellIdx);
+    mapGrid.terrainHeights[idx] = terrainHeight;
+    mapGrid.unitIntrinsicHeights[idx] = unitIntrinsicHeight;
+    mapGrid.obstacleIntrinsicHeights[idx] = obstacleIntrinsicHeight;
+    mapGrid.obstacleTopHeights[idx] = obstacleTopHeight;
+    mapGrid.unitTopHeights[idx] = unitTopHeight;
+    int totalHeight = unitComp ? unitTopHeight : obstacleTopHeight;
+    bool heightChanged = mapGrid.totalHeights[idx] != totalHeight;
+    mapGrid.totalHeights[idx] = totalHeight;
+    mapGrid.cellFlags[idx] = flags;
+    mapGrid.moveCosts[idx] = static_cast<uint8_t>(std::clamp(obstacleComp ? obstacleComp->moveCostSupplies : gameContext->moveRules.minMoveCostSupplies, 0, 255));
+    return heightChanged;
 }
 
-int GetTotalHeightOfUnitForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+void RefreshCellSummary(GameContext *gameContext, const Vector2i &cellIdx)
 {
-    if (!CheckMouseInMapBounds(gameContext) || gameContext->allUnits.find(cellIdx) == gameContext->allUnits.end())
+    if (!gameContext->mapGrid.InBounds(cellIdx))
     {
-        return 0;
+        return;
     }
 
-    if (gameContext->allObstacles.find(cellIdx) != gameContext->allObstacles.end())
+    MapGrid &mapGrid = gameContext->mapGrid;
+    int idx = mapGrid.CellToIndex(cellIdx);
+    int coverSourceHeight = mapGrid.GetCoverSourceHeight(idx);
+    int groundHeight = mapGrid.terrainHeights[idx];
+    uint8_t moveCost = mapGrid.moveCosts[idx];
+    uint8_t cliffFlag = mapGrid.cellFlags[idx] & CELL_FLAG_CLIFF;
+    if (UpdateCellSummary(gameContext, cellIdx))
     {
-        entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
-        auto &obstacleComp = gameContext->registry.get<Obstacle>(obstacleEntity);
-        if (obstacleComp.unitStandsOnTop)
+        mapGrid.MarkCellChanged(cellIdx);
+        mapGrid.UpdateMaxHeightPyramid(cellIdx);
+    }
+    if (mapGrid.moveCosts[idx] != moveCost || (mapGrid.cellFlags[idx] & CELL_FLAG_CLIFF) != cliffFlag)
+    {
+        mapGrid.MarkNavChanged(cellIdx);
+    }
+    if (mapGrid.GetCoverSourceHeight(idx) != coverSourceHeight || mapGrid.terrainHeights[idx] != groundHeight)
+    {
+        mapGrid.UpdateCoverAround(cellIdx);
+    }
+}
+
+void RefreshCellSummariesInRect(GameContext *gameContext, const Vector2i &minCellIdx, const Vector2i &maxCellIdx)
+{
+    for (int y = std::max(minCellIdx.y, 0); y <= std::min(maxCellIdx.y, gameContext->mapHeight - 1); y++)
+    {
+        for (int x = std::max(minCellIdx.x, 0); x <= std::min(maxCellIdx.x, gameContext->mapWidth - 1); x++)
         {
-            return GetUnitIntrinsicHeightForCellIdx(gameContext, cellIdx) + GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(gameContext, cellIdx);
+            RefreshCellSummary(gameContext, {x, y});
         }
     }
-
-    return GetTerrainHeightForCellIdx(gameContext, cellIdx) + GetUnitIntrinsicHeightForCellIdx(gameContext, cellIdx);
 }
 
-int GetTotalHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+int GetTerrainLevelForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
 {
-    if (!CheckMouseInMapBounds(gameContext))
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
     {
         return 0;
     }
+    return GetTerrainLevelForCellIdxUnchecked(gameContext, cellIdx);
+}
 
-    if (gameContext->allUnits.find(cellIdx) != gameContext->allUnits.end())
+int GetTerrainHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
     {
-        entt::entity unitEntity = gameContext->allUnits[cellIdx];
-        auto &unitcomp = gameContext->registry.get<Unit>(unitEntity);
-
-        return GetTotalHeightOfUnitForCellIdx(gameContext, cellIdx);
+        return 0;
     }
-    else
-    {
-        if (gameContext->allObstacles.find(cellIdx) != gameContext->allObstacles.end())
-        {
-            entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
-            auto &obstacleComp = gameContext->registry.get<Obstacle>(obstacleEntity);
+    return GetTerrainHeightForCellIdxUnchecked(gameContext, cellIdx);
+}
 
-            return GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(gameContext, cellIdx);
-        }
+int GetUnitIntrinsicHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
+    {
+        return 0;
     }
-
-    return GetTotalHeightOfUnitForCellIdx(gameContext, cellIdx) + GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(gameContext, cellIdx);
+    return GetUnitIntrinsicHeightForCellIdxUnchecked(gameContext, cellIdx);
 }
 
-CellSummary GetCellSummary(GameContext *gameContext, const Vector2i &cellIdx)
+int GetTopMostObstacleIntrinsicHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
 {
-    CellSummary cellSummary;
-
-    cellSummary.terrainLevel = GetTerrainLevelForCellIdx(gameContext, cellIdx);
-    cellSummary.terrainHeight = GetTerrainHeightForCellIdx(gameContext, cellIdx);
-    cellSummary.unitIntrinsicHeight = GetUnitIntrinsicHeightForCellIdx(gameContext, cellIdx);
-    cellSummary.topMostObstacleIntrinsicHeight = GetTopMostObstacleIntrinsicHeightForCellIdx(gameContext, cellIdx);
-    cellSummary.totalHeightIncludingTopMostObstacleExcludingUnit = GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(gameContext, cellIdx);
-    cellSummary.totalHeightofUnit = GetTotalHeightOfUnitForCellIdx(gameContext, cellIdx);
-    cellSummary.totalHeightForCellIdx = GetTotalHeightForCellIdx(gameContext, cellIdx);
-
-    if (gameContext->allUnits.find(cellIdx) != gameContext->allUnits.end())
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
     {
-        entt::entity unitEntity = gameContext->allUnits[cellIdx];
-        auto &unitcomp = gameContext->registry.get<Unit>(unitEntity);
-
-        cellSummary.unit = unitEntity;
-
-        if (unitcomp.stopsProjectile)
-        {
-            cellSummary.unitStopsProjectile = true;
-        }
+        return 0;
     }
-    if (gameContext->allObstacles.find(cellIdx) != gameContext->allObstacles.end())
-    {
-        entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
-        auto &obstacleComp = gameContext->registry.get<Obstacle>(obstacleEntity);
-
-        cellSummary.obstacle = obstacleEntity;
+    return GetTopMostObstacleIntrinsicHeightForCellIdxUnchecked(gameContext, cellIdx);
+}
 
-        if (obstacleComp.stopsProjectile)
-        {
-            cellSummary.obstacleStopsProjectile = true;
-        }
+int GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
+    {
+        return 0;
     }
-
-    return cellSummary;
+    return GetTotalHeightIncludingTopMostObstacleExcludingUnitForCellIdxUnchecked(gameContext, cellIdx);
 }
 
-// Vector2i HasElevationLOS(GameContext *gameContext, const float &perCellWidthFeet, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const Vector2i &betweenCellIdx)
-// {
-//     int totalHeightAtObserver = GetTotalHeightForCellIdx(gameContext, observerCellIdx);
-//     int totalHeightAtTarget = GetTotalHeightForCellIdx(gameContext, targetCellIdx);
-//     int totalHeightAtBetweenCell = GetTotalHeightForCellIdx(gameContext, betweenCellIdx);
-
-//     Vector2 tlCornerObserverRect2D = MapToWorld(observerCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-//     Vector2 tlCornerBetweenRect2D = MapToWorld(betweenCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-//     Vector2 tlCornerTargetRect2D = MapToWorld(targetCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-
-//     // Check if observer and target are adjacent
-//     if (GetChebyshevDistance(observerCellIdx, targetCellIdx) == 1)
-//     {
-//         return Vector2i{-1, -1};
-//     }
-
-//     // TODO:
-//     // 1. Project total height at observer to a cube that is 3.28 feet wide and totalHeightAtObserver tall.
-//     // 2. Project total height at between cell to a cube that is 3.28 feet wide and totalHeightAtBetweenCell tall.
-//     // 3. Project total height at target to a cube that is 3.28 feet wide and totalHeightAtTarget tall.
-//     // 4. Create a 3d line raycast between the top of the observer cube and the top of the target cube
-//     // 5. If the 3d raycast intersects the between cube, return betweenCellIdx, else return {-1, -1}
-
-//     // If the between cell is not blocking, return {-1, -1}
-//     return Vector2i{-1, -1};
-// }
-
-Vector2i HasElevationLOS(GameContext *gameContext, const float &perCellWidthFeet, const Vector2i &observerCellIdx, const Vector2i &targetCellIdx, const Vector2i &betweenCellIdx)
+int GetTotalHeightOfUnitForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
 {
-    // Check if observer and target are adjacent
-    if (GetChebyshevDistance(observerCellIdx, targetCellIdx) == 1)
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
     {
-        return Vector2i{-1, -1};
+        return 0;
     }
+    return GetTotalHeightOfUnitForCellIdxUnchecked(gameContext, cellIdx);
+}
 
-    int totalHeightAtObserver = GetTotalHeightForCellIdx(gameContext, observerCellIdx);
-    int totalHeightAtTarget = GetTotalHeightForCellIdx(gameContext, targetCellIdx);
-    int totalHeightAtBetweenCell = GetTotalHeightForCellIdx(gameContext, betweenCellIdx);
-
-    Vector2 tlCornerObserverRect2D = MapToWorld(observerCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-    Vector2 tlCornerBetweenRect2D = MapToWorld(betweenCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-    Vector2 tlCornerTargetRect2D = MapToWorld(targetCellIdx, gameContext->cellWidth, gameContext->cellHeight);
-
-    // Project 2D cells to 3D cubes
-    BoundingBox observerBox = CreateGridCellBoundingBox(tlCornerObserverRect2D.x, tlCornerObserverRect2D.y, gameContext->cellWidth, gameContext->cellHeight, totalHeightAtObserver);
-    BoundingBox betweenBox = CreateGridCellBoundingBox(tlCornerBetweenRect2D.x, tlCornerBetweenRect2D.y, gameContext->cellWidth, gameContext->cellHeight, totalHeightAtBetweenCell);
-    BoundingBox targetBox = CreateGridCellBoundingBox(tlCornerTargetRect2D.x, tlCornerTargetRect2D.y, gameContext->cellWidth, gameContext->cellHeight, totalHeightAtTarget);
-
-    // Cast ray from top center of observerBox to top center of targetBox
-    Vector3 observerTopCenter;
-    observerTopCenter.x = observerBox.min.x + (gameContext->cellWidth / 2);
-    observerTopCenter.y = observerBox.min.y + (gameContext->cellHeight / 2);
-    observerTopCenter.z = observerBox.max.z;
-
-    Vector3 targetTopCenter;
-    targetTopCenter.x = targetBox.min.x + (gameContext->cellWidth / 2);
-    targetTopCenter.y = targetBox.min.y + (gameContext->cellHeight / 2);
-    targetTopCenter.z = targetBox.max.z;
-
-    Ray ray;
-    ray.position = observerTopCenter;
-    ray.direction = MyVector3Normalize(MyVector3Subtract(targetTopCenter, observerTopCenter));
-
-    RayCollision collision = GetRayCollisionBox(ray, betweenBox);
+int GetTotalHeightForCellIdx(GameContext *gameContext, const Vector2i &cellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
+    {
+        return 0;
+    }
+    return GetTotalHeightForCellIdxUnchecked(gameContext, cellIdx);
+}
 
-    if (collision.hit)
+CellSummary GetCellSummary(GameContext *gameContext, const Vector2i &cellIdx)
+{
+    if (!CheckCellInMapBounds(gameContext, cellIdx))
     {
-        return betweenCellIdx;
+        return CellSummary();
     }
+    return GetCellSummaryUnchecked(gameContext, cellIdx);
+}
 
-    // If the between cell is not blocking, return {-1, -1}
-    return Vector2i{-1, -1};
+CellSummary GetCellSummaryUnchecked(const GameContext *gameContext, const Vector2i &cellIdx)
+{
+    CellSummary cellSummary;
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    int idx = mapGrid.CellToIndex(cellIdx);
+
+    cellSummary.unit = mapGrid.units[idx];
+    cellSummary.obstacle = mapGrid.obstacles[idx];
+    cellSummary.unitStopsProjectile = mapGrid.cellFlags[idx] & CELL_FLAG_UNIT_STOPS_PROJECTILE;
+    cellSummary.obstacleStopsProjectile = mapGrid.cellFlags[idx] & CELL_FLAG_OBSTACLE_STOPS_PROJECTILE;
+
+    cellSummary.terrainLevel = mapGrid.terrainLevels[idx];
+    cellSummary.terrainHeight = mapGrid.terrainHeights[idx];
+    cellSummary.unitIntrinsicHeight = mapGrid.unitIntrinsicHeights[idx];
+    cellSummary.topMostObstacleIntrinsicHeight = mapGrid.obstacleIntrinsicHeights[idx];
+    cellSummary.totalHeightIncludingTopMostObstacleExcludingUnit = mapGrid.obstacleTopHeights[idx];
+    cellSummary.totalHeightofUnit = mapGrid.unitTopHeights[idx];
+    cellSummary.totalHeightForCellIdx = mapGrid.totalHeights[idx];
+
+    return cellSummary;
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "map_json_helpers.h"
+#include "file_helpers.h"
+#include <iostream>
+#include <stdexcept>
+
+// Integer-only "(x, y)" parser; avoids the allocations and float round trip of Vector2StringToVector2
+bool ParseVector2iString(const std::string &vector2String, Vector2i &result)
+{
+    int values[2] = {0, 0};
+    int valueCount = 0;
+    const char *c = vector2String.c_str();
+    while (*c != '\0' && valueCount < 2)
+    {
+        if (*c == '-' || (*c >= '0' && *c <= '9'))
+        {
+            bool negative = *c == '-';
+            if (negative)
+            {
+                c++;
+            }
+            if (*c < '0' || *c > '9')
+            {
+                return false;
+            }
+
+            int value = 0;
+            while (*c >= '0' && *c <= '9')
+            {
+                value = value * 10 + (*c - '0');
+                c++;
+            }
+            values[valueCount++] = negative ? -value : value;
+            continue;
+        }
+        c++;
+    }
+
+    if (valueCount != 2)
+    {
+        return false;
+    }
+    result = {values[0], values[1]};
+    return true;
+}
+
+// Collects map dimensions and compact cell records without building a DOM. Only the keys the loader needs are
+// tracked; everything else in the document is skipped.
+class MapCellSaxHandler : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+    explicit MapCellSaxHandler(JsonMapCells &mapCells) : mapCells(mapCells) {}
+
+    std::string errorMessage;
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t val) override { return OnNumber(static_cast<int64_t>(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return OnNumber(static_cast<int64_t>(val)); }
+    bool number_float(number_float_t val, const string_t &) override { return OnNumber(static_cast<int64_t>(val)); }
+    bool binary(binary_t &) override { return true; }
+
+    bool string(string_t &val) override
+    {
+        if (section == Section::CELL_DATA && depth == 3 && currentKey == "cell_atlas_coords")
+        {
+            hasAtlasCoords = ParseVector2iString(val, atlasCoords);
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+        depth++;
+        if (depth == 2)
+        {
+            section = currentKey == "cell_data" ? Section::CELL_DATA : currentKey == "meta" ? Section::META : Section::OTHER;
+        }
+        else if (depth == 3 && section == Section::CELL_DATA)
+        {
+            cellKey = currentKey;
+            hasCellIdx = ParseVector2iString(cellKey, cellIdx);
+            hasAtlasCoords = false;
+            atlasId = -1;
+        }
+        else if (depth == 3 && section == Section::META)
+        {
+            inMapDimensions = currentKey == "map_dimensions";
+        }
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (depth == 3 && section == Section::CELL_DATA)
+        {
+            EmitCell();
+        }
+        else if (depth == 3 && section == Section::META)
+        {
+            inMapDimensions = false;
+        }
+        else if (depth == 2)
+        {
+            section = Section::OTHER;
+        }
+        depth--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        depth++;
+        return true;
+    }
+
+    bool end_array() override
+    {
+        depth--;
+        return true;
+    }
+
+    bool key(string_t &val) override
+    {
+        currentKey = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+    {
+        errorMessage = ex.what();
+        return false;
+    }
+
+private:
+    enum class Section
+    {
+        OTHER,
+        CELL_DATA,
+        META
+    };
+
+    JsonMapCells &mapCells;
+    int depth = 0;
+    Section section = Section::OTHER;
+    std::string currentKey;
+    bool inMapDimensions = false;
+
+    std::string cellKey;
+    bool hasCellIdx = false;
+    bool hasAtlasCoords = false;
+    Vector2i cellIdx = {0, 0};
+    Vector2i atlasCoords = {0, 0};
+    int64_t atlasId = -1;
+
+    bool OnNumber(const int64_t &value)
+    {
+        if (section == Section::CELL_DATA && depth == 3 && currentKey == "cell_source_id")
+        {
+            atlasId = value;
+        }
+        else if (section == Section::META && depth == 3 && inMapDimensions)
+        {
+            if (currentKey == "map_width")
+            {
+                mapCells.mapWidth = static_cast<int>(value);
+            }
+            else if (currentKey == "map_height")
+            {
+                mapCells.mapHeight = static_cast<int>(value);
+            }
+        }
+        return true;
+    }
+
+    void EmitCell()
+    {
+        if (!hasCellIdx || !hasAtlasCoords || atlasId < 0)
+        {
+            std::cerr << "Skipping incomplete map cell " << cellKey << std::endl;
+            return;
+        }
+        if (cellIdx.x < 0 || cellIdx.y < 0 || cellIdx.x > 0xFFFF || cellIdx.y > 0xFFFF || atlasId > 0xFFFF ||
+            atlasCoords.x < 0 || atlasCoords.y < 0 || atlasCoords.x > 0xFFFF || atlasCoords.y > 0xFFFF)
+        {
+            std::cerr << "Skipping map cell with out of range data " << cellKey << std::endl;
+            return;
+        }
+
+        mapCells.cells.push_back({static_cast<uint16_t>(cellIdx.x), static_cast<uint16_t>(cellIdx.y), static_cast<uint16_t>(atlasId),
+                                  static_cast<uint16_t>(atlasCoords.x), static_cast<uint16_t>(atlasCoords.y)});
+    }
+};
+
+JsonMapCells LoadJsonMapCells(const std::string &filePath)
+{
+    JsonMapCells mapCells;
+    MapCellSaxHandler handler(mapCells);
+
+    // Parse straight from the mapped file so neither the text nor a DOM is copied onto the heap
+    MappedFile mappedFile = MapFileReadOnly(filePath);
+    bool parsed = nlohmann::json::sax_parse(mappedFile.data, mappedFile.data + mappedFile.size, &handler);
+    UnmapFile(mappedFile);
+
+    if (!parsed)
+    {
+        throw std::runtime_error("Error reading map file " + filePath + ": " + handler.errorMessage);
+    }
+    if (mapCells.mapWidth <= 0 || mapCells.mapHeight <= 0)
+    {
+        throw std::runtime_error("Missing or invalid map dimensions in " + filePath);
+    }
+
+    return mapCells;
+}
\ No newline at end of file
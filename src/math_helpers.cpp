@@ -112,28 +112,10 @@ std::vector<Vector2i> GetBresenhamCells(const Vector2i &startCellIdx, const Vect
 std::vector<Vector2i> GetCellsOverlappingLine(const Vector2 &startWorldPos, const Vector2 &endWorldPos, const int &cellWidth, const int &cellHeight)
 {
     std::vector<Vector2i> cells;
-
-    // Calculate direction and length of the line
-    Vector2 direction = {endWorldPos.x - startWorldPos.x, endWorldPos.y - startWorldPos.y};
-    float length = sqrt(direction.x * direction.x + direction.y * direction.y);
-    direction.x /= length;
-    direction.y /= length;
-
-    float stepSize = 1.0f;
-
-    // Traverse the line and determine the cells it overlaps
-    for (float t = 0; t <= length; t += stepSize)
-    {
-        Vector2 currentPos = {startWorldPos.x + direction.x * t, startWorldPos.y + direction.y * t};
-        Vector2i cell = WorldToMap(currentPos, cellWidth, cellHeight);
-
-        // Check if the cell is already added to the list
-        if (std::find(cells.begin(), cells.end(), cell) == cells.end())
-        {
-            cells.push_back(cell);
-        }
-    }
-
+    TraverseGridLine(startWorldPos, endWorldPos, cellWidth, cellHeight, false, [&](const Vector2i &cell, float, float)
+                     {
+                         cells.push_back(cell);
+                         return true; });
     return cells;
 }
 
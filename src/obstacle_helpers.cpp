@@ -1,23 +1,19 @@
 #include "obstacle_helpers.h"
+#include "map_helpers.h"
 
 void CreateObstacle(GameContext *gameContext, const std::string &type, const Vector2i &cellIdx)
 {
+    int templateId = gameContext->GetObstacleTemplateId(type);
+    if (templateId < 0)
+    {
+        std::cerr << "Unknown obstacle type " << type << std::endl;
+        return;
+    }
+
     entt::entity obstacleEntity = gameContext->registry.create();
-    gameContext->allObstacles[cellIdx] = obstacleEntity;
+    gameContext->mapGrid.SetObstacle(cellIdx, obstacleEntity);
 
-    Obstacle newObstacle;
-    newObstacle.atlasId = gameContext->obstacleTemplates[type]["atlas_id"];
-    newObstacle.atlasCoords = Vector2i{gameContext->obstacleTemplates[type]["atlas_coords"]["x"], gameContext->obstacleTemplates[type]["atlas_coords"]["y"]};
-    newObstacle.type = type;
+    Obstacle &newObstacle = gameContext->registry.emplace<Obstacle>(obstacleEntity, gameContext->compiledObstacleTemplates[templateId].prototype);
     newObstacle.cellIdx = cellIdx;
-    newObstacle.displayName = gameContext->obstacleTemplates[type]["display_name"];
-    newObstacle.intrinsicHeight = gameContext->obstacleTemplates[type]["intrinsic_height"];
-    newObstacle.unitStandsOnTop = gameContext->obstacleTemplates[type]["unit_stands_on_top"];
-    newObstacle.stopsProjectile = gameContext->obstacleTemplates[type]["stops_projectile"];
-    newObstacle.isDestructible = gameContext->obstacleTemplates[type]["is_destructible"];
-    newObstacle.maxHealth = gameContext->obstacleTemplates[type]["max_health"];
-    newObstacle.currentHealth = gameContext->obstacleTemplates[type]["max_health"];
-    newObstacle.moveCostSupplies = gameContext->obstacleTemplates[type]["move_cost"];
-
-    gameContext->registry.emplace<Obstacle>(obstacleEntity, newObstacle);
+    RefreshCellSummary(gameContext, cellIdx);
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "osmap_helpers.h"
+#include "map_helpers.h"
+#include "map_json_helpers.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static void WriteUint32LE(std::ofstream &file, const uint32_t &value)
+{
+    unsigned char bytes[4] = {static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24)};
+    file.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+static uint32_t ReadUint32LE(const unsigned char *bytes)
+{
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// A packed cell doubles as the lookup key for its obstacle template
+static uint32_t PackOsmapCell(const int &atlasId, const int &atlasX, const int &atlasY)
+{
+    return static_cast<uint32_t>(atlasId & 0xFFFF) | (static_cast<uint32_t>(atlasX & 0xFF) << 16) | (static_cast<uint32_t>(atlasY & 0xFF) << 24);
+}
+
+void CompileJsonMapToOsmap(const std::string &jsonMapPath, const std::string &osmapPath)
+{
+    JsonMapCells mapCells = LoadJsonMapCells(jsonMapPath);
+    int mapWidth = mapCells.mapWidth;
+    int mapHeight = mapCells.mapHeight;
+
+    std::vector<uint32_t> cells(static_cast<size_t>(mapWidth) * mapHeight, PackOsmapCell(OSMAP_EMPTY_ATLAS_ID, 0, 0));
+    for (const MapCellRecord &cell : mapCells.cells)
+    {
+        if (cell.cellX >= mapWidth || cell.cellY >= mapHeight)
+        {
+            std::cerr << "Skipping out of bounds cell (" << cell.cellX << ", " << cell.cellY << ") in " << jsonMapPath << std::endl;
+            continue;
+        }
+        if (cell.atlasId >= OSMAP_EMPTY_ATLAS_ID || cell.atlasX > 0xFF || cell.atlasY > 0xFF)
+        {
+            throw std::runtime_error("Cell (" + std::to_string(cell.cellX) + ", " + std::to_string(cell.cellY) + ") in " + jsonMapPath + " has atlas data that does not fit the .osmap format");
+        }
+
+        cells[static_cast<size_t>(cell.cellY) * mapWidth + cell.cellX] = PackOsmapCell(cell.atlasId, cell.atlasX, cell.atlasY);
+    }
+
+    // Write to a temporary file first so an interrupted compile never leaves a truncated map behind
+    std::string tempPath = osmapPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::ios_base::failure("Failed to open the file: " + tempPath);
+        }
+
+        file.write(OSMAP_MAGIC, sizeof(OSMAP_MAGIC));
+        WriteUint32LE(file, OSMAP_VERSION);
+        WriteUint32LE(file, static_cast<uint32_t>(mapWidth));
+        WriteUint32LE(file, static_cast<uint32_t>(mapHeight));
+        WriteUint32LE(file, static_cast<uint32_t>(OSMAP_HEADER_SIZE));
+        WriteUint32LE(file, 0); // reserved
+
+        for (const uint32_t &cell : cells)
+        {
+            WriteUint32LE(file, cell);
+        }
+
+        if (!file)
+        {
+            throw std::ios_base::failure("Failed to write the file: " + tempPath);
+        }
+    }
+
+    std::filesystem::rename(tempPath, osmapPath);
+}
+
+OsmapHeader ReadOsmapHeader(const MappedFile &mappedFile, const std::string &filePath)
+{
+    if (mappedFile.size < OSMAP_HEADER_SIZE || std::memcmp(mappedFile.data, OSMAP_MAGIC, sizeof(OSMAP_MAGIC)) != 0)
+    {
+        throw std::runtime_error("Not an .osmap file: " + filePath);
+    }
+
+    OsmapHeader header;
+    header.version = ReadUint32LE(mappedFile.data + 4);
+    header.mapWidth = ReadUint32LE(mappedFile.data + 8);
+    header.mapHeight = ReadUint32LE(mappedFile.data + 12);
+    header.cellDataOffset = ReadUint32LE(mappedFile.data + 16);
+
+    if (header.version != OSMAP_VERSION)
+    {
+        throw std::runtime_error("Unsupported .osmap version " + std::to_string(header.version) + ": " + filePath);
+    }
+
+    uint64_t cellCount = static_cast<uint64_t>(header.mapWidth) * header.mapHeight;
+    if (header.mapWidth == 0 || header.mapHeight == 0 || header.mapWidth > 0xFFFF || header.mapHeight > 0xFFFF ||
+        header.cellDataOffset < OSMAP_HEADER_SIZE || header.cellDataOffset + cellCount * OSMAP_CELL_SIZE > mappedFile.size)
+    {
+        throw std::runtime_error("Corrupt .osmap header: " + filePath);
+    }
+
+    return header;
+}
+
+// filePath is where the .osmap lives, mapName what the game calls the map
+void BuildMapFromOsmap(GameContext *gameContext, const std::string &filePath, const std::string &mapName)
+{
+    MappedFile mappedFile = MapFileReadOnly(filePath);
+    std::vector<int> templateIds;
+
+    try
+    {
+        OsmapHeader header = ReadOsmapHeader(mappedFile, filePath);
+
+        gameContext->currentMap = mapName;
+        gameContext->mapWidth = static_cast<int>(header.mapWidth);
+        gameContext->mapHeight = static_cast<int>(header.mapHeight);
+
+        // Decode and resolve row bands in parallel straight out of the mapping
+        templateIds.assign(static_cast<size_t>(gameContext->mapWidth) * gameContext->mapHeight, -1);
+        std::atomic<int> unresolvedCount{0};
+        const unsigned char *cellData = mappedFile.data + header.cellDataOffset;
+        gameContext->threadPool.ParallelFor(gameContext->mapHeight, 16, [&](int beginRow, int endRow)
+                                            {
+            int unresolved = 0;
+            for (size_t i = static_cast<size_t>(beginRow) * gameContext->mapWidth; i < static_cast<size_t>(endRow) * gameContext->mapWidth; i++)
+            {
+                uint32_t packedCell = ReadUint32LE(cellData + i * OSMAP_CELL_SIZE);
+                int atlasId = static_cast<int>(packedCell & 0xFFFF);
+                if (atlasId == OSMAP_EMPTY_ATLAS_ID)
+                {
+                    continue;
+                }
+
+                Vector2i atlasCoords = {static_cast<int>((packedCell >> 16) & 0xFF), static_cast<int>(packedCell >> 24)};
+                templateIds[i] = gameContext->GetObstacleTemplateIdByAtlasCoords(atlasId, atlasCoords);
+                unresolved += templateIds[i] < 0;
+            }
+            unresolvedCount += unresolved; });
+
+        if (unresolvedCount > 0)
+        {
+            std::cerr << unresolvedCount << " cells in " << filePath << " have no matching obstacle template" << std::endl;
+        }
+
+    }
+    catch (...)
+    {
+        UnmapFile(mappedFile);
+        throw;
+    }
+
+    UnmapFile(mappedFile);
+    BuildMapFromTemplateIds(gameContext, templateIds);
+}
+
+// Compiled maps are a per-user cache, so the game never writes into its own resources, which may be read-only
+static std::filesystem::path GetMapCacheDirectory()
+{
+#if defined(_WIN32)
+    const char *cacheRoot = std::getenv("LOCALAPPDATA");
+    std::filesystem::path cachePath = cacheRoot ? std::filesystem::path(cacheRoot) : std::filesystem::temp_directory_path();
+#else
+    const char *xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+    const char *home = std::getenv("HOME");
+    std::filesystem::path cachePath = xdgCacheHome && *xdgCacheHome ? std::filesystem::path(xdgCacheHome)
+                                      : home && *home            ? std::filesystem::path(home) / ".cache"
+                                                                 : std::filesystem::temp_directory_path();
+#endif
+    return cachePath / "open-strategy" / "maps";
+}
+
+// Whether filePath holds an .osmap this build can load, e.g. not one left behind by another version or cut short
+static bool IsOsmapReadable(const std::string &filePath)
+{
+    try
+    {
+        MappedFile mappedFile = MapFileReadOnly(filePath);
+        try
+        {
+            ReadOsmapHeader(mappedFile, filePath);
+        }
+        catch (...)
+        {
+            UnmapFile(mappedFile);
+            throw;
+        }
+        UnmapFile(mappedFile);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Discarding cached map: " << e.what() << "\n";
+        return false;
+    }
+}
+
+// Path of the up to date .osmap for a JSON map, compiled into the map cache first when it is missing or older than
+// the JSON. Empty when mapName is not a JSON map or compiling failed, in which case the map is loaded as it is.
+std::string GetCompiledMapPath(const std::string &mapName)
+{
+    std::filesystem::path mapPath = std::filesystem::path("maps") / mapName;
+    if (mapPath.extension() != ".json")
+    {
+        return "";
+    }
+
+    try
+    {
+        // Installs and builds can share the cache, so the name also carries the source map's location and the format
+        // version
+        std::string absoluteMapPath = std::filesystem::absolute(mapPath).lexically_normal().string();
+        std::ostringstream cacheName;
+        cacheName << std::filesystem::path(mapName).stem().string() << "-" << std::hex << std::hash<std::string>()(absoluteMapPath) << std::dec << "-v" << OSMAP_VERSION << ".osmap";
+        std::filesystem::path cacheDirectory = GetMapCacheDirectory();
+        std::filesystem::path osmapPath = cacheDirectory / cacheName.str();
+
+        if (std::filesystem::exists(osmapPath) && std::filesystem::last_write_time(osmapPath) >= std::filesystem::last_write_time(mapPath) &&
+            IsOsmapReadable(osmapPath.string()))
+        {
+            return osmapPath.string();
+        }
+
+        std::filesystem::create_directories(cacheDirectory);
+        std::cout << "Compiling " << mapPath.string() << " to " << osmapPath.string() << std::endl;
+        CompileJsonMapToOsmap(mapPath.string(), osmapPath.string());
+        return osmapPath.string();
+    }
+    catch (const std::exception &e)
+    {
+        // Fall back to loading the JSON map directly
+        std::cerr << "Error compiling map: " << e.what() << "\n";
+        return "";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,626 @@
+#include "path_hierarchy.h"
+
+// Open stretches of a border up to this long get one entrance in their middle, longer ones one at each end
+static const int MAX_SINGLE_ENTRANCE_LENGTH = 6;
+
+static const int SIDE_OFFSETS_X[PATH_CLUSTER_SIDE_COUNT] = {-1, 1, 0, 0};
+static const int SIDE_OFFSETS_Y[PATH_CLUSTER_SIDE_COUNT] = {0, 0, -1, 1};
+
+static void GetClusterBounds(const MapGrid &mapGrid, const int &clusterIdx, const int &clustersX, Vector2i &outMinCellIdx, Vector2i &outMaxCellIdx)
+{
+    outMinCellIdx = {(clusterIdx % clustersX) << MapGrid::CHUNK_SHIFT, (clusterIdx / clustersX) << MapGrid::CHUNK_SHIFT};
+    outMaxCellIdx = {std::min(outMinCellIdx.x + MapGrid::CHUNK_MASK, mapGrid.width - 1), std::min(outMinCellIdx.y + MapGrid::CHUNK_MASK, mapGrid.height - 1)};
+}
+
+static int GetClusterIdxOfCell(const PathHierarchy &hierarchy, const Vector2i &cellIdx)
+{
+    return (cellIdx.y >> MapGrid::CHUNK_SHIFT) * hierarchy.clustersX + (cellIdx.x >> MapGrid::CHUNK_SHIFT);
+}
+
+// A cluster is one MapGrid chunk, so its cells sit next to each other in every layer. Searches inside a cluster work
+// on local coordinates and index the layers from the chunk's first cell with (y << CHUNK_SHIFT) | x.
+struct ClusterCells
+{
+    Vector2i minCellIdx;
+    int width;
+    int height;
+    const int *terrainLevels;
+    const uint8_t *moveCosts;
+    const entt::entity *units;
+};
+
+static ClusterCells GetClusterCells(const MapGrid &mapGrid, const int &clusterIdx)
+{
+    ClusterCells cells;
+    Vector2i maxCellIdx;
+    GetClusterBounds(mapGrid, clusterIdx, mapGrid.chunksX, cells.minCellIdx, maxCellIdx);
+    cells.width = maxCellIdx.x - cells.minCellIdx.x + 1;
+    cells.height = maxCellIdx.y - cells.minCellIdx.y + 1;
+    size_t chunkBase = static_cast<size_t>(clusterIdx) << (MapGrid::CHUNK_SHIFT * 2);
+    cells.terrainLevels = &mapGrid.terrainLevels[chunkBase];
+    cells.moveCosts = &mapGrid.moveCosts[chunkBase];
+    cells.units = &mapGrid.units[chunkBase];
+    return cells;
+}
+
+static int GetClusterLocalIdx(const int &x, const int &y)
+{
+    return (y << MapGrid::CHUNK_SHIFT) | x;
+}
+
+static int GetClusterLocalIdx(const ClusterCells &cells, const Vector2i &cellIdx)
+{
+    return GetClusterLocalIdx(cellIdx.x - cells.minCellIdx.x, cellIdx.y - cells.minCellIdx.y);
+}
+
+// GetStepCostSupplies for a step from local cell (x, y) that has to stay inside the cluster
+static int GetClusterStepCostSupplies(const MoveRules &moveRules, const ClusterCells &cells, const int &x, const int &y, const int &direction)
+{
+    int toX = x + COVER_DIRECTION_OFFSETS_X[direction];
+    int toY = y + COVER_DIRECTION_OFFSETS_Y[direction];
+    if (toX < 0 || toY < 0 || toX >= cells.width || toY >= cells.height)
+    {
+        return -1;
+    }
+
+    int fromLevel = cells.terrainLevels[GetClusterLocalIdx(x, y)];
+    int toIdx = GetClusterLocalIdx(toX, toY);
+    int toLevel = cells.terrainLevels[toIdx];
+    if (!IsClimbAllowed(moveRules, fromLevel, toLevel))
+    {
+        return -1;
+    }
+    if (direction % 2 == 1)
+    {
+        int sideLevelA = cells.terrainLevels[GetClusterLocalIdx(toX, y)];
+        int sideLevelB = cells.terrainLevels[GetClusterLocalIdx(x, toY)];
+        if (!IsClimbAllowed(moveRules, fromLevel, sideLevelA) || !IsClimbAllowed(moveRules, toLevel, sideLevelA) ||
+            !IsClimbAllowed(moveRules, fromLevel, sideLevelB) || !IsClimbAllowed(moveRules, toLevel, sideLevelB))
+        {
+            return -1;
+        }
+    }
+    return cells.moveCosts[toIdx] + GetClimbCostSupplies(moveRules, fromLevel, toLevel);
+}
+
+// Scratch memory of the searches inside one cluster, by local index
+struct ClusterSearchScratch
+{
+    int64_t costs[MapGrid::CHUNK_AREA];
+    uint8_t parentDirections[MapGrid::CHUNK_AREA];
+    uint8_t isClosed[MapGrid::CHUNK_AREA];
+    std::vector<PathHeapNode> openHeap;
+};
+
+// Dijkstra inside one cluster, ignoring units. A forward search leaves the cost from the source to every cell of the
+// cluster in scratch.costs (-1 when unreachable), a reverse search the cost from every cell to the source.
+static void SearchCluster(const MoveRules &moveRules, const ClusterCells &cells, const Vector2i &sourceCellIdx, const bool &reverse, ClusterSearchScratch &scratch)
+{
+    std::fill(std::begin(scratch.costs), std::end(scratch.costs), -1);
+    int sourceX = sourceCellIdx.x - cells.minCellIdx.x;
+    int sourceY = sourceCellIdx.y - cells.minCellIdx.y;
+    scratch.costs[GetClusterLocalIdx(sourceX, sourceY)] = 0;
+    scratch.openHeap.clear();
+    scratch.openHeap.push_back({0, sourceX, sourceY});
+
+    int sign = reverse ? -1 : 1;
+    while (!scratch.openHeap.empty())
+    {
+        std::pop_heap(scratch.openHeap.begin(), scratch.openHeap.end(), IsPathHeapNodeWorse);
+        PathHeapNode node = scratch.openHeap.back();
+        scratch.openHeap.pop_back();
+        if (node.estimatedCost != scratch.costs[GetClusterLocalIdx(node.x, node.y)])
+        {
+            continue;
+        }
+
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            int otherX = node.x + sign * COVER_DIRECTION_OFFSETS_X[direction];
+            int otherY = node.y + sign * COVER_DIRECTION_OFFSETS_Y[direction];
+            if (otherX < 0 || otherY < 0 || otherX >= cells.width || otherY >= cells.height)
+            {
+                continue;
+            }
+            int stepSupplies = reverse ? GetClusterStepCostSupplies(moveRules, cells, otherX, otherY, direction) : GetClusterStepCostSupplies(moveRules, cells, node.x, node.y, direction);
+            if (stepSupplies < 0)
+            {
+                continue;
+            }
+
+            int64_t otherCost = node.estimatedCost + GetStepSearchCost(stepSupplies, direction);
+            int64_t &storedCost = scratch.costs[GetClusterLocalIdx(otherX, otherY)];
+            if (storedCost >= 0 && storedCost <= otherCost)
+            {
+                continue;
+            }
+            storedCost = otherCost;
+            scratch.openHeap.push_back({otherCost, otherX, otherY});
+            std::push_heap(scratch.openHeap.begin(), scratch.openHeap.end(), IsPathHeapNodeWorse);
+        }
+    }
+}
+
+// FindPath between two cells of one cluster, appended to path
+static bool FindClusterPath(const MoveRules &moveRules, const ClusterCells &cells, const Vector2i &startCellIdx, const Vector2i &goalCellIdx, ClusterSearchScratch &scratch, MovePath &path)
+{
+    std::fill(std::begin(scratch.costs), std::end(scratch.costs), -1);
+    std::fill(std::begin(scratch.isClosed), std::end(scratch.isClosed), 0);
+    Vector2i start = {startCellIdx.x - cells.minCellIdx.x, startCellIdx.y - cells.minCellIdx.y};
+    Vector2i goal = {goalCellIdx.x - cells.minCellIdx.x, goalCellIdx.y - cells.minCellIdx.y};
+    int goalIdx = GetClusterLocalIdx(goal.x, goal.y);
+    scratch.costs[GetClusterLocalIdx(start.x, start.y)] = 0;
+    scratch.openHeap.clear();
+    scratch.openHeap.push_back({GetPathHeuristicCost(moveRules, start, goal), start.x, start.y});
+
+    while (!scratch.openHeap.empty())
+    {
+        std::pop_heap(scratch.openHeap.begin(), scratch.openHeap.end(), IsPathHeapNodeWorse);
+        PathHeapNode node = scratch.openHeap.back();
+        scratch.openHeap.pop_back();
+        int idx = GetClusterLocalIdx(node.x, node.y);
+        if (scratch.isClosed[idx])
+        {
+            continue;
+        }
+        scratch.isClosed[idx] = 1;
+
+        if (idx == goalIdx)
+        {
+            size_t firstNewCell = path.cellIdxs.size();
+            path.supplyCost += static_cast<int>(scratch.costs[idx] >> PATH_SUPPLY_COST_SHIFT);
+            Vector2i cell = goal;
+            while (!(cell == start))
+            {
+                path.cellIdxs.push_back({cell.x + cells.minCellIdx.x, cell.y + cells.minCellIdx.y});
+                int direction = scratch.parentDirections[GetClusterLocalIdx(cell.x, cell.y)];
+                cell = {cell.x - COVER_DIRECTION_OFFSETS_X[direction], cell.y - COVER_DIRECTION_OFFSETS_Y[direction]};
+            }
+            std::reverse(path.cellIdxs.begin() + firstNewCell, path.cellIdxs.end());
+            return true;
+        }
+
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            int stepSupplies = GetClusterStepCostSupplies(moveRules, cells, node.x, node.y, direction);
+            Vector2i to = {node.x + COVER_DIRECTION_OFFSETS_X[direction], node.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+            if (stepSupplies < 0)
+            {
+                continue;
+            }
+            int toIdx = GetClusterLocalIdx(to.x, to.y);
+            if (scratch.isClosed[toIdx] || (toIdx != goalIdx && cells.units[toIdx] != entt::null))
+            {
+                continue;
+            }
+
+            int64_t toCost = scratch.costs[idx] + GetStepSearchCost(stepSupplies, direction);
+            if (scratch.costs[toIdx] >= 0 && scratch.costs[toIdx] <= toCost)
+            {
+                continue;
+            }
+            scratch.costs[toIdx] = toCost;
+            scratch.parentDirections[toIdx] = static_cast<uint8_t>(direction);
+            scratch.openHeap.push_back({toCost + GetPathHeuristicCost(moveRules, to, goal), to.x, to.y});
+            std::push_heap(scratch.openHeap.begin(), scratch.openHeap.end(), IsPathHeapNodeWorse);
+        }
+    }
+    return false;
+}
+
+// Finds the entrances of the border that starts at firstCellIdxA and runs for length cells, crossing it in direction
+// (COVER_EAST or COVER_SOUTH)
+static void BuildBorder(const MapGrid &mapGrid, const MoveRules &moveRules, const Vector2i &firstCellIdxA, const int &direction, const int &length, std::vector<PathEntrance> &outEntrances)
+{
+    outEntrances.clear();
+    Vector2i alongStep = direction == COVER_EAST ? Vector2i{0, 1} : Vector2i{1, 0};
+    int backDirection = (direction + COVER_DIRECTION_COUNT / 2) % COVER_DIRECTION_COUNT;
+
+    auto addEntrance = [&](const int &offset)
+    {
+        PathEntrance entrance;
+        entrance.cellIdxA = {firstCellIdxA.x + alongStep.x * offset, firstCellIdxA.y + alongStep.y * offset};
+        entrance.cellIdxB = {entrance.cellIdxA.x + COVER_DIRECTION_OFFSETS_X[direction], entrance.cellIdxA.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+        int toIdx;
+        entrance.costAToBSupplies = GetStepCostSupplies(mapGrid, moveRules, entrance.cellIdxA, direction, toIdx);
+        entrance.costBToASupplies = GetStepCostSupplies(mapGrid, moveRules, entrance.cellIdxB, backDirection, toIdx);
+        outEntrances.push_back(entrance);
+    };
+
+    int runStart = -1;
+    for (int offset = 0; offset <= length; offset++)
+    {
+        bool isOpen = false;
+        if (offset < length)
+        {
+            Vector2i cellIdxA = {firstCellIdxA.x + alongStep.x * offset, firstCellIdxA.y + alongStep.y * offset};
+            int toIdx;
+            isOpen = GetStepCostSupplies(mapGrid, moveRules, cellIdxA, direction, toIdx) >= 0;
+        }
+
+        if (isOpen && runStart < 0)
+        {
+            runStart = offset;
+        }
+        else if (!isOpen && runStart >= 0)
+        {
+            int runLength = offset - runStart;
+            if (runLength <= MAX_SINGLE_ENTRANCE_LENGTH)
+            {
+                addEntrance(runStart + runLength / 2);
+            }
+            else
+            {
+                addEntrance(runStart);
+                addEntrance(offset - 1);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+static bool AreEntrancesEqual(const std::vector<PathEntrance> &a, const std::vector<PathEntrance> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (!(a[i].cellIdxA == b[i].cellIdxA) || a[i].costAToBSupplies != b[i].costAToBSupplies || a[i].costBToASupplies != b[i].costBToASupplies)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Entrances on one side of a cluster, or nullptr on the map edge
+static const std::vector<PathEntrance> *GetSideEntrances(const PathHierarchy &hierarchy, const int &clusterIdx, const int &side)
+{
+    int clusterX = clusterIdx % hierarchy.clustersX;
+    int clusterY = clusterIdx / hierarchy.clustersX;
+    switch (side)
+    {
+    case PATH_CLUSTER_WEST:
+        return clusterX > 0 ? &hierarchy.eastBorders[clusterIdx - 1] : nullptr;
+    case PATH_CLUSTER_EAST:
+        return clusterX < hierarchy.clustersX - 1 ? &hierarchy.eastBorders[clusterIdx] : nullptr;
+    case PATH_CLUSTER_NORTH:
+        return clusterY > 0 ? &hierarchy.southBorders[clusterIdx - hierarchy.clustersX] : nullptr;
+    default:
+        return clusterY < hierarchy.clustersY - 1 ? &hierarchy.southBorders[clusterIdx] : nullptr;
+    }
+}
+
+// Collects the cluster's nodes from its borders and searches the costs between all of them
+static void BuildCluster(const MapGrid &mapGrid, const MoveRules &moveRules, const PathHierarchy &hierarchy, const int &clusterIdx, PathCluster &cluster, ClusterSearchScratch &scratch)
+{
+    cluster.nodeCellIdxs.clear();
+    for (int side = 0; side < PATH_CLUSTER_SIDE_COUNT; side++)
+    {
+        cluster.sideNodeOffsets[side] = static_cast<int>(cluster.nodeCellIdxs.size());
+        const std::vector<PathEntrance> *entrances = GetSideEntrances(hierarchy, clusterIdx, side);
+        if (entrances == nullptr)
+        {
+            continue;
+        }
+        // The west and north neighbours are the A side of the shared border
+        bool isSideB = side == PATH_CLUSTER_WEST || side == PATH_CLUSTER_NORTH;
+        for (const PathEntrance &entrance : *entrances)
+        {
+            cluster.nodeCellIdxs.push_back(isSideB ? entrance.cellIdxB : entrance.cellIdxA);
+        }
+    }
+    int nodeCount = static_cast<int>(cluster.nodeCellIdxs.size());
+    cluster.sideNodeOffsets[PATH_CLUSTER_SIDE_COUNT] = nodeCount;
+
+    ClusterCells cells = GetClusterCells(mapGrid, clusterIdx);
+    cluster.nodeCosts.assign(static_cast<size_t>(nodeCount) * nodeCount, -1);
+    for (int fromNode = 0; fromNode < nodeCount; fromNode++)
+    {
+        SearchCluster(moveRules, cells, cluster.nodeCellIdxs[fromNode], false, scratch);
+        for (int toNode = 0; toNode < nodeCount; toNode++)
+        {
+            cluster.nodeCosts[fromNode * nodeCount + toNode] = scratch.costs[GetClusterLocalIdx(cells, cluster.nodeCellIdxs[toNode])];
+        }
+    }
+    cluster.navVersion = mapGrid.chunkNavVersions[clusterIdx];
+}
+
+// Rebuilds the clusters whose chunks changed since they were built. Their borders are rebuilt too, and a neighbour
+// only gets its costs searched again when the border it shares with them actually changed.
+void UpdatePathHierarchy(const MapGrid &mapGrid, const MoveRules &moveRules, ThreadPool &threadPool, PathHierarchy &hierarchy)
+{
+    int clusterCount = mapGrid.chunksX * mapGrid.chunksY;
+    if (hierarchy.clustersX != mapGrid.chunksX || hierarchy.clustersY != mapGrid.chunksY)
+    {
+        hierarchy.clustersX = mapGrid.chunksX;
+        hierarchy.clustersY = mapGrid.chunksY;
+        hierarchy.clusters.assign(clusterCount, PathCluster());
+        hierarchy.eastBorders.assign(clusterCount, {});
+        hierarchy.southBorders.assign(clusterCount, {});
+    }
+
+    std::vector<int> staleClusterIdxs;
+    for (int clusterIdx = 0; clusterIdx < clusterCount; clusterIdx++)
+    {
+        if (hierarchy.clusters[clusterIdx].navVersion != mapGrid.chunkNavVersions[clusterIdx])
+        {
+            staleClusterIdxs.push_back(clusterIdx);
+        }
+    }
+    if (staleClusterIdxs.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> isDirty(clusterCount, 0);
+    for (int clusterIdx : staleClusterIdxs)
+    {
+        isDirty[clusterIdx] = 1;
+    }
+    std::vector<PathEntrance> entrances;
+    auto rebuildBorder = [&](const int &clusterIdxA, const int &direction)
+    {
+        Vector2i minCellIdx, maxCellIdx;
+        GetClusterBounds(mapGrid, clusterIdxA, hierarchy.clustersX, minCellIdx, maxCellIdx);
+        int clusterIdxB = direction == COVER_EAST ? clusterIdxA + 1 : clusterIdxA + hierarchy.clustersX;
+        std::vector<PathEntrance> &border = direction == COVER_EAST ? hierarchy.eastBorders[clusterIdxA] : hierarchy.southBorders[clusterIdxA];
+        if (direction == COVER_EAST)
+        {
+            BuildBorder(mapGrid, moveRules, {maxCellIdx.x, minCellIdx.y}, direction, maxCellIdx.y - minCellIdx.y + 1, entrances);
+        }
+        else
+        {
+            BuildBorder(mapGrid, moveRules, {minCellIdx.x, maxCellIdx.y}, direction, maxCellIdx.x - minCellIdx.x + 1, entrances);
+        }
+        if (!AreEntrancesEqual(border, entrances))
+        {
+            border.swap(entrances);
+            isDirty[clusterIdxA] = 1;
+            isDirty[clusterIdxB] = 1;
+        }
+    };
+    for (int clusterIdx : staleClusterIdxs)
+    {
+        int clusterX = clusterIdx % hierarchy.clustersX;
+        int clusterY = clusterIdx / hierarchy.clustersX;
+        if (clusterX < hierarchy.clustersX - 1)
+        {
+            rebuildBorder(clusterIdx, COVER_EAST);
+        }
+        if (clusterY < hierarchy.clustersY - 1)
+        {
+            rebuildBorder(clusterIdx, COVER_SOUTH);
+        }
+        // A stale neighbour rebuilds the shared border itself
+        if (clusterX > 0 && hierarchy.clusters[clusterIdx - 1].navVersion == mapGrid.chunkNavVersions[clusterIdx - 1])
+        {
+            rebuildBorder(clusterIdx - 1, COVER_EAST);
+        }
+        if (clusterY > 0 && hierarchy.clusters[clusterIdx - hierarchy.clustersX].navVersion == mapGrid.chunkNavVersions[clusterIdx - hierarchy.clustersX])
+        {
+            rebuildBorder(clusterIdx - hierarchy.clustersX, COVER_SOUTH);
+        }
+    }
+
+    std::vector<int> dirtyClusterIdxs;
+    for (int clusterIdx = 0; clusterIdx < clusterCount; clusterIdx++)
+    {
+        if (isDirty[clusterIdx])
+        {
+            dirtyClusterIdxs.push_back(clusterIdx);
+        }
+    }
+    threadPool.ParallelFor(static_cast<int>(dirtyClusterIdxs.size()), 16, [&](int begin, int end)
+                           {
+        ClusterSearchScratch scratch;
+        for (int i = begin; i < end; i++)
+        {
+            BuildCluster(mapGrid, moveRules, hierarchy, dirtyClusterIdxs[i], hierarchy.clusters[dirtyClusterIdxs[i]], scratch);
+        } });
+
+    // Node ids are handed out cluster by cluster
+    hierarchy.nodeClusterIdxs.clear();
+    for (int clusterIdx = 0; clusterIdx < clusterCount; clusterIdx++)
+    {
+        PathCluster &cluster = hierarchy.clusters[clusterIdx];
+        cluster.firstNodeId = static_cast<int>(hierarchy.nodeClusterIdxs.size());
+        hierarchy.nodeClusterIdxs.insert(hierarchy.nodeClusterIdxs.end(), cluster.nodeCellIdxs.size(), clusterIdx);
+    }
+}
+
+// Appends the refined path from cellIdx to toCellIdx, which lies in the same cluster or right across its border
+static bool RefinePathSegment(const MapGrid &mapGrid, const MoveRules &moveRules, const PathHierarchy &hierarchy, ClusterSearchScratch &scratch, Vector2i &cellIdx, const Vector2i &toCellIdx, MovePath &path)
+{
+    int clusterIdx = GetClusterIdxOfCell(hierarchy, toCellIdx);
+    if (GetClusterIdxOfCell(hierarchy, cellIdx) != clusterIdx)
+    {
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction += 2)
+        {
+            if (cellIdx.x + COVER_DIRECTION_OFFSETS_X[direction] == toCellIdx.x && cellIdx.y + COVER_DIRECTION_OFFSETS_Y[direction] == toCellIdx.y)
+            {
+                int toIdx;
+                path.supplyCost += GetStepCostSupplies(mapGrid, moveRules, cellIdx, direction, toIdx);
+                path.cellIdxs.push_back(toCellIdx);
+                cellIdx = toCellIdx;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (!FindClusterPath(moveRules, GetClusterCells(mapGrid, clusterIdx), cellIdx, toCellIdx, scratch, path))
+    {
+        return false;
+    }
+    cellIdx = toCellIdx;
+    return true;
+}
+
+// Searches the abstract graph between the start and goal clusters, then refines the route one cluster at a time.
+// Falls back to FindPath for nearby goals, and when units block the refined route.
+MovePath FindHierarchicalPath(const MapGrid &mapGrid, const MoveRules &moveRules, const PathHierarchy &hierarchy, PathSearchBuffer &buffer, const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies)
+{
+    if (!mapGrid.InBounds(startCellIdx) || !mapGrid.InBounds(goalCellIdx) || maxSupplies < 0)
+    {
+        return MovePath();
+    }
+    int startClusterIdx = GetClusterIdxOfCell(hierarchy, startCellIdx);
+    int goalClusterIdx = GetClusterIdxOfCell(hierarchy, goalCellIdx);
+    bool isNearby = std::abs((startCellIdx.x >> MapGrid::CHUNK_SHIFT) - (goalCellIdx.x >> MapGrid::CHUNK_SHIFT)) <= 1 && std::abs((startCellIdx.y >> MapGrid::CHUNK_SHIFT) - (goalCellIdx.y >> MapGrid::CHUNK_SHIFT)) <= 1;
+    if (isNearby || hierarchy.clustersX != mapGrid.chunksX || hierarchy.clustersY != mapGrid.chunksY)
+    {
+        return FindPath(mapGrid, moveRules, buffer, startCellIdx, goalCellIdx, maxSupplies);
+    }
+    if (!IsStandableCell(mapGrid, mapGrid.CellToIndex(goalCellIdx)))
+    {
+        return MovePath();
+    }
+
+    // Connect the start and goal cells to the nodes of their clusters
+    ClusterSearchScratch scratch;
+    const PathCluster &startCluster = hierarchy.clusters[startClusterIdx];
+    const PathCluster &goalCluster = hierarchy.clusters[goalClusterIdx];
+    ClusterCells startCells = GetClusterCells(mapGrid, startClusterIdx);
+    SearchCluster(moveRules, startCells, startCellIdx, false, scratch);
+    std::vector<int64_t> startCosts;
+    for (const Vector2i &nodeCellIdx : startCluster.nodeCellIdxs)
+    {
+        startCosts.push_back(scratch.costs[GetClusterLocalIdx(startCells, nodeCellIdx)]);
+    }
+    ClusterCells goalCells = GetClusterCells(mapGrid, goalClusterIdx);
+    SearchCluster(moveRules, goalCells, goalCellIdx, true, scratch);
+    std::vector<int64_t> goalCosts;
+    for (const Vector2i &nodeCellIdx : goalCluster.nodeCellIdxs)
+    {
+        goalCosts.push_back(scratch.costs[GetClusterLocalIdx(goalCells, nodeCellIdx)]);
+    }
+
+    // A* over the nodes; the goal gets the id after the last node
+    int goalNodeId = static_cast<int>(hierarchy.nodeClusterIdxs.size());
+    buffer.BeginNodeSearch(goalNodeId + 1);
+    const uint32_t openStamp = buffer.nodeOpenStamp;
+    const uint32_t closedStamp = openStamp + 1;
+    const int64_t overBudgetCost = MakePathSearchCost(static_cast<int64_t>(maxSupplies) + 1, 0);
+    std::vector<PathNodeHeapEntry> &openHeap = buffer.nodeOpenHeap;
+    auto isWorse = [](const PathNodeHeapEntry &a, const PathNodeHeapEntry &b)
+    {
+        return a.estimatedCost > b.estimatedCost;
+    };
+    auto relax = [&](const int &nodeId, const int64_t &cost, const int &parentNodeId, const int64_t &heuristicCost)
+    {
+        if (buffer.nodeStamps[nodeId] == closedStamp || (buffer.nodeStamps[nodeId] == openStamp && buffer.nodeCosts[nodeId] <= cost))
+        {
+            return;
+        }
+        buffer.nodeStamps[nodeId] = openStamp;
+        buffer.nodeCosts[nodeId] = cost;
+        buffer.nodeParents[nodeId] = parentNodeId;
+        if (cost + heuristicCost < overBudgetCost)
+        {
+            openHeap.push_back({cost + heuristicCost, nodeId});
+            std::push_heap(openHeap.begin(), openHeap.end(), isWorse);
+        }
+    };
+
+    for (size_t node = 0; node < startCosts.size(); node++)
+    {
+        if (startCosts[node] >= 0)
+        {
+            relax(startCluster.firstNodeId + static_cast<int>(node), startCosts[node], -1, GetPathHeuristicCost(moveRules, startCluster.nodeCellIdxs[node], goalCellIdx));
+        }
+    }
+
+    bool foundGoal = false;
+    while (!openHeap.empty())
+    {
+        std::pop_heap(openHeap.begin(), openHeap.end(), isWorse);
+        PathNodeHeapEntry entry = openHeap.back();
+        openHeap.pop_back();
+        if (buffer.nodeStamps[entry.nodeId] == closedStamp)
+        {
+            continue;
+        }
+        buffer.nodeStamps[entry.nodeId] = closedStamp;
+        if (entry.nodeId == goalNodeId)
+        {
+            foundGoal = true;
+            break;
+        }
+
+        int clusterIdx = hierarchy.nodeClusterIdxs[entry.nodeId];
+        const PathCluster &cluster = hierarchy.clusters[clusterIdx];
+        int node = entry.nodeId - cluster.firstNodeId;
+        int nodeCount = static_cast<int>(cluster.nodeCellIdxs.size());
+        int64_t cost = buffer.nodeCosts[entry.nodeId];
+
+        if (clusterIdx == goalClusterIdx && goalCosts[node] >= 0)
+        {
+            relax(goalNodeId, cost + goalCosts[node], entry.nodeId, 0);
+        }
+        for (int toNode = 0; toNode < nodeCount; toNode++)
+        {
+            int64_t nodeCost = cluster.nodeCosts[node * nodeCount + toNode];
+            if (toNode != node && nodeCost >= 0)
+            {
+                relax(cluster.firstNodeId + toNode, cost + nodeCost, entry.nodeId, GetPathHeuristicCost(moveRules, cluster.nodeCellIdxs[toNode], goalCellIdx));
+            }
+        }
+
+        // Across the border to the matching node of the neighbouring cluster
+        int side = 0;
+        while (node >= cluster.sideNodeOffsets[side + 1])
+        {
+            side++;
+        }
+        const PathEntrance &entrance = (*GetSideEntrances(hierarchy, clusterIdx, side))[node - cluster.sideNodeOffsets[side]];
+        bool isSideB = side == PATH_CLUSTER_WEST || side == PATH_CLUSTER_NORTH;
+        int crossingSupplies = isSideB ? entrance.costBToASupplies : entrance.costAToBSupplies;
+        if (crossingSupplies >= 0)
+        {
+            int neighborClusterIdx = clusterIdx + SIDE_OFFSETS_Y[side] * hierarchy.clustersX + SIDE_OFFSETS_X[side];
+            const PathCluster &neighborCluster = hierarchy.clusters[neighborClusterIdx];
+            int neighborNode = neighborCluster.sideNodeOffsets[side ^ 1] + node - cluster.sideNodeOffsets[side];
+            relax(neighborCluster.firstNodeId + neighborNode, cost + MakePathSearchCost(crossingSupplies, PATH_STEP_LENGTH_ORTHOGONAL), entry.nodeId, GetPathHeuristicCost(moveRules, neighborCluster.nodeCellIdxs[neighborNode], goalCellIdx));
+        }
+    }
+    if (!foundGoal)
+    {
+        return MovePath();
+    }
+
+    std::vector<Vector2i> waypoints = {goalCellIdx};
+    for (int nodeId = buffer.nodeParents[goalNodeId]; nodeId >= 0; nodeId = buffer.nodeParents[nodeId])
+    {
+        const PathCluster &cluster = hierarchy.clusters[hierarchy.nodeClusterIdxs[nodeId]];
+        waypoints.push_back(cluster.nodeCellIdxs[nodeId - cluster.firstNodeId]);
+    }
+    std::reverse(waypoints.begin(), waypoints.end());
+
+    MovePath path;
+    path.found = true;
+    Vector2i cellIdx = startCellIdx;
+    for (const Vector2i &waypoint : waypoints)
+    {
+        if (!RefinePathSegment(mapGrid, moveRules, hierarchy, scratch, cellIdx, waypoint, path))
+        {
+            return FindPath(mapGrid, moveRules, buffer, startCellIdx, goalCellIdx, maxSupplies);
+        }
+    }
+    // Entrance cells may hold units, which only the goal is allowed to. The abstract route can also come out a little
+    // dearer than the best one once refined, so an exact search decides whether the budget really is too small.
+    for (size_t i = 0; i + 1 < path.cellIdxs.size(); i++)
+    {
+        if (mapGrid.units[mapGrid.CellToIndex(path.cellIdxs[i])] != entt::null)
+        {
+            return FindPath(mapGrid, moveRules, buffer, startCellIdx, goalCellIdx, maxSupplies);
+        }
+    }
+    if (path.supplyCost > maxSupplies)
+    {
+        return FindPath(mapGrid, moveRules, buffer, startCellIdx, goalCellIdx, maxSupplies);
+    }
+    return path;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "path_search.h"
+
+// A* over cells free of units; only the goal may hold one, which sMoveUnits then swaps with. Gives up as soon as
+// every open route would cost more than maxSupplies.
+MovePath FindPath(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies)
+{
+    MovePath path;
+    if (!mapGrid.InBounds(startCellIdx) || !mapGrid.InBounds(goalCellIdx) || maxSupplies < 0)
+    {
+        return path;
+    }
+    if (startCellIdx == goalCellIdx)
+    {
+        path.found = true;
+        return path;
+    }
+    int goalIdx = mapGrid.CellToIndex(goalCellIdx);
+    if (!IsStandableCell(mapGrid, goalIdx))
+    {
+        return path;
+    }
+
+    buffer.BeginSearch(mapGrid.terrainLevels.size());
+    const uint32_t openStamp = buffer.openStamp;
+    const uint32_t closedStamp = openStamp + 1;
+    const int64_t overBudgetCost = MakePathSearchCost(static_cast<int64_t>(maxSupplies) + 1, 0);
+    std::vector<PathHeapNode> &openHeap = buffer.openHeap;
+
+    int startIdx = mapGrid.CellToIndex(startCellIdx);
+    buffer.costs[startIdx] = 0;
+    buffer.stamps[startIdx] = openStamp;
+    openHeap.push_back({GetPathHeuristicCost(moveRules, startCellIdx, goalCellIdx), startCellIdx.x, startCellIdx.y});
+
+    while (!openHeap.empty())
+    {
+        std::pop_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+        PathHeapNode node = openHeap.back();
+        openHeap.pop_back();
+        if (node.estimatedCost >= overBudgetCost)
+        {
+            break;
+        }
+
+        Vector2i cellIdx = {node.x, node.y};
+        int idx = mapGrid.CellToIndex(cellIdx);
+        if (buffer.stamps[idx] == closedStamp)
+        {
+            continue; // stale duplicate of a cell that was already reached more cheaply
+        }
+        buffer.stamps[idx] = closedStamp;
+
+        if (idx == goalIdx)
+        {
+            path.found = true;
+            path.supplyCost = static_cast<int>(buffer.costs[idx] >> PATH_SUPPLY_COST_SHIFT);
+            while (!(cellIdx == startCellIdx))
+            {
+                path.cellIdxs.push_back(cellIdx);
+                int direction = buffer.parentDirections[mapGrid.CellToIndex(cellIdx)];
+                cellIdx = {cellIdx.x - COVER_DIRECTION_OFFSETS_X[direction], cellIdx.y - COVER_DIRECTION_OFFSETS_Y[direction]};
+            }
+            std::reverse(path.cellIdxs.begin(), path.cellIdxs.end());
+            return path;
+        }
+
+        int64_t cost = buffer.costs[idx];
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            int toIdx;
+            int stepSupplies = GetStepCostSupplies(mapGrid, moveRules, cellIdx, direction, toIdx);
+            if (stepSupplies < 0 || buffer.stamps[toIdx] == closedStamp || (toIdx != goalIdx && mapGrid.units[toIdx] != entt::null))
+            {
+                continue;
+            }
+
+            int64_t toCost = cost + GetStepSearchCost(stepSupplies, direction);
+            if (buffer.stamps[toIdx] == openStamp && buffer.costs[toIdx] <= toCost)
+            {
+                continue;
+            }
+            buffer.stamps[toIdx] = openStamp;
+            buffer.costs[toIdx] = toCost;
+            buffer.parentDirections[toIdx] = static_cast<uint8_t>(direction);
+
+            Vector2i toCellIdx = {node.x + COVER_DIRECTION_OFFSETS_X[direction], node.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+            int64_t estimatedCost = toCost + GetPathHeuristicCost(moveRules, toCellIdx, goalCellIdx);
+            if (estimatedCost < overBudgetCost)
+            {
+                openHeap.push_back({estimatedCost, toCellIdx.x, toCellIdx.y});
+                std::push_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+            }
+        }
+    }
+
+    return path;
+}
+
+// Dijkstra from originCellIdx under the same rules as FindPath, stopping at the supply budget
+void ComputeReachability(const MapGrid &mapGrid, const MoveRules &moveRules, PathSearchBuffer &buffer, const Vector2i &originCellIdx, const int &maxSupplies, ReachabilityField &field)
+{
+    field.originCellIdx = originCellIdx;
+    field.maxSupplies = maxSupplies;
+    field.navVersion = mapGrid.navVersion;
+    field.occupancyVersion = mapGrid.occupancyVersion;
+    field.windowWidth = 0;
+    field.windowHeight = 0;
+    if (!mapGrid.InBounds(originCellIdx) || maxSupplies < 0)
+    {
+        field.costs.clear();
+        field.parentDirections.clear();
+        field.canStop.clear();
+        return;
+    }
+
+    // Every step costs at least minMoveCostSupplies, which bounds how far the budget reaches
+    int radius = moveRules.minMoveCostSupplies > 0 ? maxSupplies / moveRules.minMoveCostSupplies : std::max(mapGrid.width, mapGrid.height);
+    field.minCellIdx = {std::max(originCellIdx.x - radius, 0), std::max(originCellIdx.y - radius, 0)};
+    field.windowWidth = std::min(originCellIdx.x + radius, mapGrid.width - 1) - field.minCellIdx.x + 1;
+    field.windowHeight = std::min(originCellIdx.y + radius, mapGrid.height - 1) - field.minCellIdx.y + 1;
+    size_t windowArea = static_cast<size_t>(field.windowWidth) * field.windowHeight;
+    field.costs.assign(windowArea, -1);
+    field.parentDirections.assign(windowArea, 0);
+    field.canStop.assign(windowArea, 0);
+
+    const int64_t overBudgetCost = MakePathSearchCost(static_cast<int64_t>(maxSupplies) + 1, 0);
+    std::vector<PathHeapNode> &openHeap = buffer.openHeap;
+    openHeap.clear();
+
+    int originWindowIdx = field.GetWindowIdx(originCellIdx);
+    field.costs[originWindowIdx] = 0;
+    field.canStop[originWindowIdx] = 1;
+    openHeap.push_back({0, originCellIdx.x, originCellIdx.y});
+
+    while (!openHeap.empty())
+    {
+        std::pop_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+        PathHeapNode node = openHeap.back();
+        openHeap.pop_back();
+
+        Vector2i cellIdx = {node.x, node.y};
+        if (node.estimatedCost != field.costs[field.GetWindowIdx(cellIdx)])
+        {
+            continue; // stale duplicate of a cell that was since reached more cheaply
+        }
+        if (!(cellIdx == originCellIdx) && mapGrid.units[mapGrid.CellToIndex(cellIdx)] != entt::null)
+        {
+            continue; // a unit's cell can be moved to (sMoveUnits swaps), but not through
+        }
+
+        for (int direction = 0; direction < COVER_DIRECTION_COUNT; direction++)
+        {
+            int toIdx;
+            int stepSupplies = GetStepCostSupplies(mapGrid, moveRules, cellIdx, direction, toIdx);
+            if (stepSupplies < 0)
+            {
+                continue;
+            }
+
+            int64_t toCost = node.estimatedCost + GetStepSearchCost(stepSupplies, direction);
+            Vector2i toCellIdx = {node.x + COVER_DIRECTION_OFFSETS_X[direction], node.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+            int toWindowIdx = field.GetWindowIdx(toCellIdx);
+            if (toCost >= overBudgetCost || toWindowIdx < 0 || (field.costs[toWindowIdx] >= 0 && field.costs[toWindowIdx] <= toCost))
+            {
+                continue;
+            }
+            field.costs[toWindowIdx] = toCost;
+            field.parentDirections[toWindowIdx] = static_cast<uint8_t>(direction);
+            field.canStop[toWindowIdx] = IsStandableCell(mapGrid, toIdx);
+
+            openHeap.push_back({toCost, toCellIdx.x, toCellIdx.y});
+            std::push_heap(openHeap.begin(), openHeap.end(), IsPathHeapNodeWorse);
+        }
+    }
+}
\ No newline at end of file
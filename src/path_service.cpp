@@ -0,0 +1,141 @@
+#include "path_service.h"
+
+// Finished searches are kept to answer repeated requests, e.g. every frame the mouse hovers the same cell, until the
+// movement state changes or there are more of them than this
+static const size_t MAX_FINISHED_JOB_COUNT = 4096;
+
+PathService::PathService(const MapGrid &mapGrid, const MoveRules &moveRules, PathHierarchy &pathHierarchy, ThreadPool &threadPool, unsigned int workerCount)
+    : mapGrid(mapGrid), moveRules(moveRules), pathHierarchy(pathHierarchy), threadPool(threadPool), workers(workerCount)
+{
+}
+
+PathService::~PathService()
+{
+    // Queued tasks still run while the workers shut down, but return right away
+    isStopping = true;
+}
+
+std::shared_ptr<PathJob> PathService::FindOrQueueJob(const PathJobKey &key)
+{
+    auto it = jobs.find(key);
+    if (it != jobs.end())
+    {
+        return it->second;
+    }
+
+    std::shared_ptr<PathJob> job = std::make_shared<PathJob>();
+    job->key = key;
+    jobs.emplace(key, job);
+    queuedJobs.push_back(job);
+    return job;
+}
+
+// FindHierarchicalPath from startCellIdx to goalCellIdx, e.g. for GetUnitLongMovePath; onDone gets the path in a later Poll
+void PathService::RequestPath(const Vector2i &startCellIdx, const Vector2i &goalCellIdx, const int &maxSupplies, PathCallback onDone)
+{
+    PathJobKey key = {PathJobKinds::MOVE_PATH, startCellIdx, goalCellIdx, maxSupplies, mapGrid.navVersion, mapGrid.occupancyVersion};
+    waiters.push_back({FindOrQueueJob(key), std::move(onDone), nullptr});
+}
+
+void PathService::RequestReachability(const Vector2i &originCellIdx, const int &maxSupplies, ReachabilityCallback onDone)
+{
+    PathJobKey key = {PathJobKinds::REACHABILITY, originCellIdx, {-1, -1}, maxSupplies, mapGrid.navVersion, mapGrid.occupancyVersion};
+    waiters.push_back({FindOrQueueJob(key), nullptr, std::move(onDone)});
+}
+
+// Call once per frame. Hands finished results to their callbacks, forgets results the movement state has moved past
+// and starts the searches requested since the last call.
+void PathService::Poll()
+{
+    // Callbacks may request again, which appends to waiters
+    std::vector<PathWaiter> pendingWaiters;
+    pendingWaiters.swap(waiters);
+    for (PathWaiter &waiter : pendingWaiters)
+    {
+        if (!waiter.job->isDone.load(std::memory_order_acquire))
+        {
+            waiters.push_back(std::move(waiter));
+        }
+        else if (waiter.onPath)
+        {
+            waiter.onPath(waiter.job->path);
+        }
+        else if (waiter.onReachability)
+        {
+            waiter.onReachability(waiter.job->field);
+        }
+    }
+
+    bool isOverCapacity = jobs.size() > MAX_FINISHED_JOB_COUNT;
+    for (auto it = jobs.begin(); it != jobs.end();)
+    {
+        const PathJob &job = *it->second;
+        bool isOutdated = job.key.navVersion != mapGrid.navVersion || job.key.occupancyVersion != mapGrid.occupancyVersion;
+        if (job.isDone.load(std::memory_order_acquire) && (isOutdated || isOverCapacity))
+        {
+            it = jobs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (queuedJobs.empty())
+    {
+        return;
+    }
+    UpdateHierarchy();
+    for (std::shared_ptr<PathJob> &job : queuedJobs)
+    {
+        workers.Submit([this, job]()
+                       { RunJob(*job); });
+    }
+    queuedJobs.clear();
+}
+
+// Brings the hierarchy up to date with the map, waiting for running searches first when it has to change
+void PathService::UpdateHierarchy()
+{
+    if (isHierarchyBuilt && hierarchyNavVersion == mapGrid.navVersion)
+    {
+        return;
+    }
+    WorldWriteLock lock = LockWorld();
+    UpdatePathHierarchy(mapGrid, moveRules, threadPool, pathHierarchy);
+    hierarchyNavVersion = mapGrid.navVersion;
+    isHierarchyBuilt = true;
+}
+
+PathService::WorldWriteLock PathService::LockWorld()
+{
+    WorldWriteLock lock;
+    lock.turnstile = std::unique_lock<std::mutex>(turnstileMutex);
+    lock.world = std::unique_lock<std::shared_mutex>(worldMutex);
+    return lock;
+}
+
+void PathService::RunJob(PathJob &job)
+{
+    if (!isStopping)
+    {
+        // Each worker keeps its own scratch memory, sized to the map on first use
+        thread_local PathSearchBuffer buffer;
+
+        // Queue up behind a waiting writer instead of starving it
+        {
+            std::lock_guard<std::mutex> turnstile(turnstileMutex);
+        }
+        std::shared_lock<std::shared_mutex> worldLock(worldMutex);
+        const PathJobKey &key = job.key;
+        if (key.kind == PathJobKinds::MOVE_PATH)
+        {
+            job.path = FindHierarchicalPath(mapGrid, moveRules, pathHierarchy, buffer, key.startCellIdx, key.goalCellIdx, key.maxSupplies);
+        }
+        else
+        {
+            ComputeReachability(mapGrid, moveRules, buffer, key.startCellIdx, key.maxSupplies, job.field);
+        }
+    }
+    job.isDone.store(true, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "pathfinding_helpers.h"
+#include "math_helpers.h"
+
+// Budget of long move searches; keeps their packed search costs far from overflowing
+static const int LONG_MOVE_MAX_SUPPLIES = 1 << 20;
+
+// The unit's cached reachability field. Once the unit moved or spent supplies, or the move costs or occupancy of the
+// map changed, a new one is requested from the path service and the old one is returned until it arrives, so it is
+// cheap to call every frame. Check IsUpToDate or CoversBudget before acting on it.
+const ReachabilityField &GetUnitReachability(GameContext *gameContext, const entt::entity &unitEntity)
+{
+    const Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+    ReachabilityField &field = gameContext->registry.get_or_emplace<ReachabilityField>(unitEntity);
+    if (!field.isRequestPending && !field.IsUpToDate(gameContext->mapGrid, unitComp.cellIdx, unitComp.supplies))
+    {
+        field.isRequestPending = true;
+        entt::registry *registry = &gameContext->registry;
+        gameContext->pathService.RequestReachability(unitComp.cellIdx, unitComp.supplies, [registry, unitEntity](const ReachabilityField &result)
+                                                     {
+            if (registry->valid(unitEntity) && registry->all_of<ReachabilityField>(unitEntity))
+            {
+                registry->get<ReachabilityField>(unitEntity) = result;
+            } });
+    }
+    return field;
+}
+
+// The unit's cached route to goalCellIdx, for goals beyond its reachability field. Searched by the path service with
+// the hierarchy under a budget no unit reaches, so it shows the whole way there. Like GetUnitReachability it returns
+// the previous route until the new one arrives; check IsUpToDate before acting on it.
+const LongMovePath &GetUnitLongMovePath(GameContext *gameContext, const entt::entity &unitEntity, const Vector2i &goalCellIdx)
+{
+    const Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+    LongMovePath &longMovePath = gameContext->registry.get_or_emplace<LongMovePath>(unitEntity);
+    if (!longMovePath.isRequestPending && !longMovePath.IsUpToDate(gameContext->mapGrid, unitComp.cellIdx, goalCellIdx))
+    {
+        longMovePath.isRequestPending = true;
+        LongMovePath request;
+        request.startCellIdx = unitComp.cellIdx;
+        request.goalCellIdx = goalCellIdx;
+        request.navVersion = gameContext->mapGrid.navVersion;
+        request.occupancyVersion = gameContext->mapGrid.occupancyVersion;
+        entt::registry *registry = &gameContext->registry;
+        gameContext->pathService.RequestPath(unitComp.cellIdx, goalCellIdx, LONG_MOVE_MAX_SUPPLIES, [registry, unitEntity, request](const MovePath &path) mutable
+                                             {
+            if (registry->valid(unitEntity) && registry->all_of<LongMovePath>(unitEntity))
+            {
+                request.path = path;
+                registry->get<LongMovePath>(unitEntity) = request;
+            } });
+    }
+    return longMovePath;
+}
+
+// The part of path a unit at startCellIdx can walk this turn: up to the last cell on it the unit can stop on that is
+// at most maxDistance cells from the start (-1 for no limit) and costs at most maxSupplies. Empty when there is none.
+MovePath GetMovePathPrefix(const GameContext *gameContext, const Vector2i &startCellIdx, const MovePath &path, const int &maxSupplies, const int &maxDistance)
+{
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    MovePath prefix;
+    int routeSupplies = 0;
+    size_t stopLength = 0;
+    int stopSupplies = 0;
+    Vector2i cellIdx = startCellIdx;
+    for (const Vector2i &nextCellIdx : path.cellIdxs)
+    {
+        if (maxDistance > -1 && GetChebyshevDistance(startCellIdx, nextCellIdx) > maxDistance)
+        {
+            break;
+        }
+        int direction = 0;
+        while (direction < COVER_DIRECTION_COUNT && !(Vector2i{cellIdx.x + COVER_DIRECTION_OFFSETS_X[direction], cellIdx.y + COVER_DIRECTION_OFFSETS_Y[direction]} == nextCellIdx))
+        {
+            direction++;
+        }
+        int toIdx;
+        int stepSupplies = direction < COVER_DIRECTION_COUNT ? GetStepCostSupplies(mapGrid, gameContext->moveRules, cellIdx, direction, toIdx) : -1;
+        if (stepSupplies < 0 || routeSupplies + stepSupplies > maxSupplies)
+        {
+            break;
+        }
+        routeSupplies += stepSupplies;
+        cellIdx = nextCellIdx;
+        prefix.cellIdxs.push_back(cellIdx);
+        if (IsStandableCell(mapGrid, toIdx))
+        {
+            stopLength = prefix.cellIdxs.size();
+            stopSupplies = routeSupplies;
+        }
+    }
+
+    prefix.cellIdxs.resize(stopLength);
+    prefix.found = stopLength > 0;
+    prefix.supplyCost = stopSupplies;
+    return prefix;
+}
+
+// Sends every unit without a pending move toward goalCellIdx along one shared flow field. Units get their routes
+// closest first and each stops on the last affordable cell before one an earlier unit stops on, so the group queues
+// up behind the goal. Routes only descend the field, so no unit walks through a group member that has yet to move;
+// other units on the way are swapped like on single moves. unitMaxSupplies[i] caps what unitEntities[i] may spend on
+// its route. Returns the units that were given a route.
+std::vector<entt::entity> OrderGroupMove(GameContext *gameContext, const std::vector<entt::entity> &unitEntities, const std::vector<int> &unitMaxSupplies, const Vector2i &goalCellIdx)
+{
+    entt::registry &registry = gameContext->registry;
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    std::vector<entt::entity> orderedEntities;
+    if (!mapGrid.InBounds(goalCellIdx) || !IsStandableCell(mapGrid, mapGrid.CellToIndex(goalCellIdx)))
+    {
+        return orderedEntities;
+    }
+
+    std::vector<entt::entity> movers;
+    std::vector<Vector2i> sourceCellIdxs;
+    std::unordered_map<entt::entity, int> moverMaxSupplies;
+    for (size_t i = 0; i < unitEntities.size(); i++)
+    {
+        const entt::entity &unitEntity = unitEntities[i];
+        if (registry.valid(unitEntity) && registry.all_of<Unit>(unitEntity) && !registry.all_of<MovePoints>(unitEntity) &&
+            moverMaxSupplies.emplace(unitEntity, unitMaxSupplies[i]).second)
+        {
+            movers.push_back(unitEntity);
+            sourceCellIdxs.push_back(registry.get<Unit>(unitEntity).cellIdx);
+        }
+    }
+    if (movers.empty())
+    {
+        return orderedEntities;
+    }
+
+    FlowField &field = gameContext->groupFlowField;
+    ComputeFlowField(mapGrid, gameContext->moveRules, gameContext->pathSearchBuffer, goalCellIdx, sourceCellIdxs, field);
+    movers.erase(std::remove_if(movers.begin(), movers.end(), [&](const entt::entity &unitEntity)
+                                { return !field.CanReachGoal(registry.get<Unit>(unitEntity).cellIdx); }),
+                 movers.end());
+    std::stable_sort(movers.begin(), movers.end(), [&](const entt::entity &a, const entt::entity &b)
+                     { return field.GetCost(registry.get<Unit>(a).cellIdx) < field.GetCost(registry.get<Unit>(b).cellIdx); });
+
+    std::vector<uint8_t> isClaimed(static_cast<size_t>(field.windowWidth) * field.windowHeight, 0);
+    for (const entt::entity &unitEntity : movers)
+    {
+        Unit &unitComp = registry.get<Unit>(unitEntity);
+        int maxSupplies = moverMaxSupplies[unitEntity];
+        std::vector<Vector2i> route;
+        int routeSupplies = 0;
+        size_t stopLength = 0;
+        int stopSupplies = 0;
+        Vector2i cellIdx = unitComp.cellIdx;
+        for (uint8_t direction = field.GetNextDirection(cellIdx); direction != FLOW_DIRECTION_NONE; direction = field.GetNextDirection(cellIdx))
+        {
+            Vector2i nextCellIdx = {cellIdx.x + COVER_DIRECTION_OFFSETS_X[direction], cellIdx.y + COVER_DIRECTION_OFFSETS_Y[direction]};
+            if (isClaimed[field.GetWindowIdx(nextCellIdx)])
+            {
+                break;
+            }
+            int toIdx;
+            int stepSupplies = GetStepCostSupplies(mapGrid, gameContext->moveRules, cellIdx, direction, toIdx);
+            if (routeSupplies + stepSupplies > maxSupplies)
+            {
+                break;
+            }
+            routeSupplies += stepSupplies;
+            cellIdx = nextCellIdx;
+            route.push_back(cellIdx);
+            if (IsStandableCell(mapGrid, toIdx))
+            {
+                stopLength = route.size();
+                stopSupplies = routeSupplies;
+            }
+        }
+
+        route.resize(stopLength);
+        isClaimed[field.GetWindowIdx(route.empty() ? unitComp.cellIdx : route.back())] = 1;
+        if (!route.empty())
+        {
+            registry.emplace<MovePoints>(unitEntity, std::move(route), static_cast<int>(orderedEntities.size()));
+            unitComp.supplies -= stopSupplies;
+            orderedEntities.push_back(unitEntity);
+        }
+    }
+    return orderedEntities;
+}
\ No newline at end of file
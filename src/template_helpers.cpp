@@ -0,0 +1,100 @@
+#include "template_helpers.h"
+#include <cmath>
+
+AbilityDef CompileAbilityDef(const nlohmann::json &abilityData)
+{
+    AbilityDef newAbility;
+    newAbility.type = abilityData["type"];
+    newAbility.description = abilityData["description"];
+    newAbility.requiresCell = abilityData["requires_cell"];
+    newAbility.supplyCost = abilityData["supply_cost"];
+    newAbility.maxUsesPerTurn = abilityData["max_uses_per_turn"];
+    newAbility.maxCooldown = abilityData["max_cooldown"];
+    newAbility.doesBresenhamTargeting = abilityData["does_bresenham_targeting"];
+    newAbility.doesStraightLineTargeting = abilityData["does_straight_line_targeting"];
+    newAbility.range = abilityData["range"];
+    newAbility.aoeSize = abilityData["aoe_size"];
+    newAbility.fleshDamageMax = abilityData["flesh_damage_max"];
+    newAbility.fleshDamageMin = abilityData["flesh_damage_min"];
+    newAbility.armorDamageMax = abilityData["armor_damage_max"];
+    newAbility.armorDamageMin = abilityData["armor_damage_min"];
+    newAbility.terrainDamageMax = abilityData["terrain_damage_max"];
+    newAbility.terrainDamageMin = abilityData["terrain_damage_min"];
+    newAbility.firesProjectile = abilityData["fires_projectile"];
+    newAbility.isAerialProjectile = abilityData["is_aerial_projectile"];
+    newAbility.accuracyFalloff = abilityData["accuracy_falloff"];
+    newAbility.inaccuracyRadius = abilityData["inaccuracy_radius"];
+    newAbility.createsUnit = abilityData["creates_unit"];
+    newAbility.tileEffect = abilityData["tile_effect"];
+    newAbility.suppression = abilityData["suppression"];
+    newAbility.suppressionChance = abilityData["suppression_chance"];
+    newAbility.suppressionRadius = abilityData["suppression_radius"];
+    return newAbility;
+}
+
+ObstacleTemplate CompileObstacleTemplate(const std::string &type, const nlohmann::json &templateData)
+{
+    ObstacleTemplate obstacleTemplate;
+    Obstacle &newObstacle = obstacleTemplate.prototype;
+    newObstacle.atlasId = templateData["atlas_id"];
+    newObstacle.atlasCoords = Vector2i{templateData["atlas_coords"]["x"], templateData["atlas_coords"]["y"]};
+    newObstacle.type = type;
+    newObstacle.cellIdx = {0, 0};
+    newObstacle.collisionRect = {0, 0, 0, 0};
+    newObstacle.displayName = templateData["display_name"];
+    newObstacle.intrinsicHeight = templateData["intrinsic_height"];
+    newObstacle.unitStandsOnTop = templateData["unit_stands_on_top"];
+    newObstacle.stopsProjectile = templateData["stops_projectile"];
+    newObstacle.isDestructible = templateData["is_destructible"];
+    newObstacle.maxHealth = templateData["max_health"];
+    newObstacle.currentHealth = templateData["max_health"];
+    newObstacle.moveCostSupplies = templateData["move_cost"];
+
+    obstacleTemplate.incrementTerrainHeight = templateData["increment_terrain_height"];
+    obstacleTemplate.decrementTerrainHeight = templateData["decrement_terrain_height"];
+    obstacleTemplate.continueTerrainHeight = templateData["continue_terrain_height"];
+    return obstacleTemplate;
+}
+
+UnitTemplate CompileUnitTemplate(const std::string &type, const nlohmann::json &templateData, std::vector<AbilityDef> &abilityDefs)
+{
+    UnitTemplate unitTemplate;
+    Unit &newUnit = unitTemplate.prototype;
+    newUnit.atlasId = templateData["atlas_id"];
+    newUnit.atlasCoords = Vector2i{templateData["atlas_coords"]["x"], templateData["atlas_coords"]["y"]};
+    newUnit.cellIdx = {0, 0};
+    newUnit.collisionRect = {0, 0, 0, 0};
+    newUnit.type = type;
+    newUnit.givenName = "Placeholder Name";
+    newUnit.isPerson = templateData["is_person"];
+    newUnit.isVehicle = templateData["is_vehicle"];
+    newUnit.isStructure = templateData["is_structure"];
+    newUnit.intrinsicHeight = templateData["intrinsic_height"];
+    newUnit.crouchHeight = templateData["crouch_height"];
+    newUnit.proneHeight = templateData["prone_height"];
+    newUnit.maxSupplies = templateData["max_supplies"];
+    newUnit.supplies = std::floor(newUnit.maxSupplies / 2);
+    newUnit.maxHealth = templateData["max_health"];
+    newUnit.currentHealth = newUnit.maxHealth;
+    newUnit.stopsProjectile = templateData["stops_projectile"];
+    newUnit.maxOccupancy = templateData["max_occupancy"];
+    newUnit.stance = Stances::STANDING;
+    newUnit.team = Teams::TEAM_BLUE;
+
+    unitTemplate.useVision = templateData["use_vision"];
+    unitTemplate.visionBaseWidth = unitTemplate.useVision ? templateData["vision_base_width"].get<int>() : 0;
+    unitTemplate.visionTopWidth = unitTemplate.useVision ? templateData["vision_top_width"].get<int>() : 0;
+    unitTemplate.visionLength = unitTemplate.useVision ? templateData["vision_length"].get<int>() : 0;
+
+    if (templateData.contains("abilities"))
+    {
+        for (const auto &abilityData : templateData["abilities"].items())
+        {
+            AbilityState abilityState;
+            abilityState.abilityDefId = static_cast<int>(abilityDefs.size());
+            abilityDefs.push_back(CompileAbilityDef(abilityData.value()));
+            newUnit.abilities.push_back(abilityState);
+        }
+    }
+    return unitTemplate;
+}
\ No newline at end of file
@@ -1,20 +1,26 @@
 #include "ui_helpers.h"
 #include "math_helpers.h"
 #include "map_helpers.h"
+#include "vision_helpers.h"
+#include "cover_helpers.h"
+#include "los_helpers.h"
+#include "pathfinding_helpers.h"
 
 void sDrawGameTextures(GameContext *gameContext)
 {
     Rectangle viewportRect = gameContext->GetCameraViewportWorldRect();
-    std::vector<Vector2i> cellIdxsInView = DeduceCellIdxsOverlappingRect(viewportRect, gameContext->cellWidth, gameContext->cellHeight);
+    Vector2i minCellIdx = WorldToMap({viewportRect.x, viewportRect.y}, gameContext->cellWidth, gameContext->cellHeight);
+    Vector2i maxCellIdx = WorldToMap({viewportRect.x + viewportRect.width, viewportRect.y + viewportRect.height}, gameContext->cellWidth, gameContext->cellHeight);
+    const MapGrid &mapGrid = gameContext->mapGrid;
 
     BeginMode2D(gameContext->camera);
 
     // Draw obstacles and units
-    for (auto &cellIdx : cellIdxsInView)
-    {
-        if (gameContext->allObstacles.find(cellIdx) != gameContext->allObstacles.end())
+    mapGrid.ForEachCellInRect(minCellIdx, maxCellIdx, [&](const Vector2i &cellIdx, const int &idx)
+                              {
+        entt::entity obstacleEntity = mapGrid.obstacles[idx];
+        if (obstacleEntity != entt::null)
         {
-            entt::entity obstacleEntity = gameContext->allObstacles[cellIdx];
             auto &obstacle = gameContext->registry.get<Obstacle>(obstacleEntity);
 
             int atlasCoordX = obstacle.atlasCoords.x;
@@ -35,9 +41,9 @@ void sDrawGameTextures(GameContext *gameContext)
             DrawTexturePro(gameContext->allTextures[spriteSheetName], sourceRect, destRect, {0.0f, 0.0f}, 0.0f, WHITE);
         }
 
-        if (gameContext->allUnits.find(cellIdx) != gameContext->allUnits.end())
+        entt::entity unitEntity = mapGrid.units[idx];
+        if (unitEntity != entt::null)
         {
-            entt::entity unitEntity = gameContext->allUnits[cellIdx];
             auto &unit = gameContext->registry.get<Unit>(unitEntity);
 
             int atlasCoordX = unit.atlasCoords.x;
@@ -56,21 +62,20 @@ void sDrawGameTextures(GameContext *gameContext)
                 static_cast<float>(gameContext->cellWidth),
                 static_cast<float>(gameContext->cellHeight)};
 
-            if (gameContext->registry.all_of<IsVisible>(unitEntity))
+            if (IsUnitVisibleToMyTeam(gameContext, unitEntity))
             {
                 DrawTexturePro(gameContext->allTextures[spriteSheetName], sourceRect, destRect, {0.0f, 0.0f}, 0.0f, WHITE);
             }
-        }
-    }
+        } });
 
     // Draw trapezoids after units and obstacles
     // TODO: decouple trapezoids from view culling / check trap viewport collision (should draw unit trapezoid even if its parent unit isn't in viewport)
     // TODO: either consolidate this into the unit drawing step to avoid the extra iteration, or move this block into its own function to separate concerns
-    for (auto &cellIdx : cellIdxsInView)
-    {
-        if (gameContext->allUnits.find(cellIdx) != gameContext->allUnits.end())
+    mapGrid.ForEachCellInRect(minCellIdx, maxCellIdx, [&](const Vector2i &cellIdx, const int &idx)
+                              {
+        entt::entity unitEntity = mapGrid.units[idx];
+        if (unitEntity != entt::null)
         {
-            entt::entity unitEntity = gameContext->allUnits[cellIdx];
             auto visionTrapEntity = gameContext->registry.try_get<IsoscelesTrapezoid>(unitEntity);
             if (visionTrapEntity != nullptr)
             {
@@ -81,8 +86,7 @@ void sDrawGameTextures(GameContext *gameContext)
                     DrawTriangle(visionTrapezoidComp.p1, visionTrapezoidComp.p3, visionTrapezoidComp.p4, Fade(WHITE, 0.1f));
                 }
             }
-        }
-    }
+        } });
 
     EndMode2D();
 }
@@ -184,10 +188,10 @@ void sDrawUnitDetails(GameContext *gameContext)
     Vector2 mousePosWorld = GetScreenToWorld2D(mousePosScreen, gameContext->camera);
     Vector2i mousePosCellIdx = WorldToMap(mousePosWorld, gameContext->cellWidth, gameContext->cellHeight);
 
-    if (gameContext->allUnits.find(mousePosCellIdx) != gameContext->allUnits.end())
+    if (gameContext->mapGrid.HasUnit(mousePosCellIdx))
     {
-        entt::entity hoveredUnit = gameContext->allUnits[mousePosCellIdx];
-        if (!gameContext->registry.all_of<IsVisible>(hoveredUnit))
+        entt::entity hoveredUnit = gameContext->mapGrid.GetUnit(mousePosCellIdx);
+        if (!IsUnitVisibleToMyTeam(gameContext, hoveredUnit))
         {
             return;
         }
@@ -274,15 +278,15 @@ void sDrawHoveredCellInfo(GameContext *gameContext)
     std::string cellInfo = gameContext->currentMap + " : " + "(" + std::to_string(mousePosCellIdx.x) + ", " + std::to_string(mousePosCellIdx.y) + ")";
     cellInfo += " : Level: " + std::to_string(cellSummary.terrainLevel) + " ";
     cellInfo += " : Terrain height: " + std::to_string(cellSummary.terrainHeight) + "; ";
-    if (gameContext->allObstacles.find(mousePosCellIdx) != gameContext->allObstacles.end())
+    if (gameContext->mapGrid.HasObstacle(mousePosCellIdx))
     {
         cellInfo += "Total obstacle elev: " + std::to_string(cellSummary.totalHeightIncludingTopMostObstacleExcludingUnit) + "ft; ";
     }
-    if (gameContext->allUnits.find(mousePosCellIdx) != gameContext->allUnits.end() && cellSummary.unit != entt::null && gameContext->registry.all_of<IsVisible>(cellSummary.unit))
+    if (gameContext->mapGrid.HasUnit(mousePosCellIdx) && cellSummary.unit != entt::null && IsUnitVisibleToMyTeam(gameContext, cellSummary.unit))
     {
         cellInfo += "Total unit elev: " + std::to_string(cellSummary.totalHeightofUnit) + "ft; ";
     }
-    if (cellSummary.unit != entt::null && gameContext->registry.all_of<IsVisible>(cellSummary.unit))
+    if (cellSummary.unit != entt::null && IsUnitVisibleToMyTeam(gameContext, cellSummary.unit))
     {
         cellInfo += "Total elev " + std::to_string(cellSummary.totalHeightForCellIdx) + "ft; ";
     }
@@ -295,6 +299,11 @@ void sDrawHoveredCellInfo(GameContext *gameContext)
         auto &obstacleComp = gameContext->registry.get<Obstacle>(cellSummary.obstacle);
         cellInfo += " : " + obstacleComp.displayName;
     }
+    if (gameContext->selectedUnit != entt::null)
+    {
+        auto &selectedUnitComp = gameContext->registry.get<Unit>(gameContext->selectedUnit);
+        cellInfo += " : Cover vs selected: " + std::to_string(GetCoverHeightAgainst(gameContext, mousePosCellIdx, selectedUnitComp.cellIdx)) + "ft";
+    }
     int textWidth = MeasureText(cellInfo.c_str(), gameContext->baseFontSize);
     int textHeight = gameContext->baseFontSize;
     int posX = gameContext->screenWidth - textWidth - 10;
@@ -325,19 +334,20 @@ void sDrawSelectedUnitAbilities(GameContext *gameContext)
         if (abilities.size() > 0)
         {
             int i = 0;
-            for (auto &ability : abilities)
+            for (auto &abilityState : abilities)
             {
+                const AbilityDef &ability = gameContext->GetAbilityDef(abilityState);
                 Color color = WHITE; // Default text color
                 bool doUnderline = false;
 
                 // Highlight the selected ability in red
-                if (selectedUnitComp.selectedAbility != nullptr && selectedUnitComp.selectedAbility->type == ability.type)
+                if (i == selectedUnitComp.selectedAbilityIdx)
                 {
                     doUnderline = true;
                 }
 
-                // if (selectedUnitComp.selectedAbility->supplyCost > selectedUnitComp.supplies ||
-                //     (selectedUnitComp.selectedAbility->maxCooldown > 0 && gameContext->turnCount - selectedUnitComp.selectedAbility->lastTurnUsed))
+                // if (ability.supplyCost > selectedUnitComp.supplies ||
+                //     (ability.maxCooldown > 0 && gameContext->turnCount - abilityState.lastTurnUsed))
                 // {
                 // }
                 if (selectedUnitComp.supplies < ability.supplyCost)
@@ -371,6 +381,11 @@ void sDrawSelectedUnitIndicator(GameContext *gameContext)
         Rectangle rect = Rectangle{selectedUnitWorldPos.x, selectedUnitWorldPos.y, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)};
         BeginMode2D(gameContext->camera);
         DrawRectangleLinesEx(rect, 2.0f, YELLOW);
+        for (const entt::entity &groupUnitEntity : gameContext->selectedGroup)
+        {
+            Vector2 groupUnitWorldPos = MapToWorld(gameContext->registry.get<Unit>(groupUnitEntity).cellIdx, gameContext->cellWidth, gameContext->cellHeight);
+            DrawRectangleLinesEx(Rectangle{groupUnitWorldPos.x, groupUnitWorldPos.y, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)}, 1.0f, YELLOW);
+        }
         EndMode2D();
     }
 }
@@ -499,29 +514,87 @@ void sDrawAbilityElements(GameContext *gameContext)
         Vector2 mousePosWorld = GetScreenToWorld2D(mousePosScreen, gameContext->camera);
         Vector2i mousePosCellIdx = WorldToMap(mousePosWorld, gameContext->cellWidth, gameContext->cellHeight);
 
-        if (!unitComp.selectedAbility)
+        const AbilityDef *selectedAbility = gameContext->GetSelectedAbilityDef(unitComp);
+        if (!selectedAbility)
         {
             return;
         }
 
         BeginMode2D(gameContext->camera);
-        if (unitComp.selectedAbility->range > 0)
+        if (selectedAbility->doesBresenhamTargeting)
+        {
+            // Movement range: every cell sUseAbilities would accept a move to. Hidden while the field still belongs to
+            // where the unit stood before.
+            const ReachabilityField &reachability = GetUnitReachability(gameContext, gameContext->selectedUnit);
+            int moveSupplies = unitComp.supplies - selectedAbility->supplyCost;
+            bool isReachabilityReady = reachability.CoversBudget(gameContext->mapGrid, unitComp.cellIdx, unitComp.supplies);
+            if (isReachabilityReady)
+            {
+                for (int y = reachability.minCellIdx.y; y < reachability.minCellIdx.y + reachability.windowHeight; y++)
+                {
+                    for (int x = reachability.minCellIdx.x; x < reachability.minCellIdx.x + reachability.windowWidth; x++)
+                    {
+                        Vector2i cellIdx = {x, y};
+                        int supplyCost = reachability.GetSupplyCost(cellIdx);
+                        if ((selectedAbility->range < 0 || GetChebyshevDistance(unitComp.cellIdx, cellIdx) <= selectedAbility->range) && supplyCost >= 0 && supplyCost <= moveSupplies)
+                        {
+                            DrawRectangleRec({static_cast<float>(x) * gameContext->cellWidth, static_cast<float>(y) * gameContext->cellHeight, static_cast<float>(gameContext->cellWidth), static_cast<float>(gameContext->cellHeight)}, Fade(WHITE, 0.2f));
+                        }
+                    }
+                }
+            }
+        }
+        else if (selectedAbility->range > 0)
         {
-            Rectangle rect = GenerateCellNeighborRect(unitComp.cellIdx, unitComp.selectedAbility->range, gameContext->cellWidth, gameContext->cellHeight);
+            Rectangle rect = GenerateCellNeighborRect(unitComp.cellIdx, selectedAbility->range, gameContext->cellWidth, gameContext->cellHeight);
             DrawRectangleRec(rect, Fade(WHITE, 0.2f));
         }
 
-        if (unitComp.selectedAbility->aoeSize > 0)
+        if (selectedAbility->aoeSize > 0)
         {
-            Rectangle rect = GenerateCellNeighborRect(mousePosCellIdx, unitComp.selectedAbility->aoeSize, gameContext->cellWidth, gameContext->cellHeight);
+            Rectangle rect = GenerateCellNeighborRect(mousePosCellIdx, selectedAbility->aoeSize, gameContext->cellWidth, gameContext->cellHeight);
             DrawRectangleRec(rect, Fade(WHITE, 0.2f));
         }
 
-        if (unitComp.selectedAbility->inaccuracyRadius > 0)
+        if (selectedAbility->inaccuracyRadius > 0)
         {
-            Rectangle rect = GenerateCellNeighborRect(mousePosCellIdx, unitComp.selectedAbility->inaccuracyRadius, gameContext->cellWidth, gameContext->cellHeight);
+            Rectangle rect = GenerateCellNeighborRect(mousePosCellIdx, selectedAbility->inaccuracyRadius, gameContext->cellWidth, gameContext->cellHeight);
             DrawRectangleRec(rect, Fade(ORANGE, 0.2f));
         }
+
+        if (selectedAbility->doesStraightLineTargeting)
+        {
+            // Shot preview: how exposed each visible enemy in range is, i.e. 1 - the hidden fraction sUseAbilities scales the
+            // cover accuracy penalty by. Red when no LOS sample sees the enemy at all.
+            Rectangle viewportRect = gameContext->GetCameraViewportWorldRect();
+            Vector2i minCellIdx = WorldToMap({viewportRect.x, viewportRect.y}, gameContext->cellWidth, gameContext->cellHeight);
+            Vector2i maxCellIdx = WorldToMap({viewportRect.x + viewportRect.width, viewportRect.y + viewportRect.height}, gameContext->cellWidth, gameContext->cellHeight);
+            if (selectedAbility->range > -1)
+            {
+                minCellIdx = {std::max(minCellIdx.x, unitComp.cellIdx.x - selectedAbility->range), std::max(minCellIdx.y, unitComp.cellIdx.y - selectedAbility->range)};
+                maxCellIdx = {std::min(maxCellIdx.x, unitComp.cellIdx.x + selectedAbility->range), std::min(maxCellIdx.y, unitComp.cellIdx.y + selectedAbility->range)};
+            }
+
+            std::vector<LOSQuery> queries;
+            gameContext->mapGrid.ForEachCellInRect(minCellIdx, maxCellIdx, [&](const Vector2i &cellIdx, const int &idx)
+                                                   {
+                entt::entity unitEntity = gameContext->mapGrid.units[idx];
+                if (unitEntity != entt::null && gameContext->registry.get<Unit>(unitEntity).team != unitComp.team && IsUnitVisibleToMyTeam(gameContext, unitEntity))
+                {
+                    queries.push_back({unitComp.cellIdx.x, unitComp.cellIdx.y, cellIdx.x, cellIdx.y});
+                } });
+
+            std::vector<float> visibleFractions(queries.size());
+            GetVisibleFractionBatch(gameContext, queries.data(), static_cast<int>(queries.size()), visibleFractions.data());
+            for (size_t i = 0; i < queries.size(); i++)
+            {
+                Vector2i targetCellIdx = {queries[i].targetX, queries[i].targetY};
+                float hiddenFraction = std::max(1.0f - visibleFractions[i], GetUnitCoverFraction(gameContext, targetCellIdx, unitComp.cellIdx));
+                std::string exposedText = std::to_string(static_cast<int>((1.0f - hiddenFraction) * 100.0f + 0.5f)) + "%";
+                Vector2 targetWorldPos = MapToWorld(targetCellIdx, gameContext->cellWidth, gameContext->cellHeight);
+                DrawText(exposedText.c_str(), static_cast<int>(targetWorldPos.x), static_cast<int>(targetWorldPos.y), gameContext->baseFontSize, visibleFractions[i] > 0.0f ? WHITE : RED);
+            }
+        }
         EndMode2D();
     }
 }
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "vision_helpers.h"
+#include "math_helpers.h"
+
+// Cells overlapped by the trapezoid's bounding box, clipped to the map. Padded by one cell because the trapezoid
+// test counts touching edges as overlap.
+void GetVisionBounds(const GameContext *gameContext, const IsoscelesTrapezoid &visionTrap, Vector2i &minCellIdx, Vector2i &maxCellIdx)
+{
+    Vector2 minPos = {std::min({visionTrap.p1.x, visionTrap.p2.x, visionTrap.p3.x, visionTrap.p4.x}), std::min({visionTrap.p1.y, visionTrap.p2.y, visionTrap.p3.y, visionTrap.p4.y})};
+    Vector2 maxPos = {std::max({visionTrap.p1.x, visionTrap.p2.x, visionTrap.p3.x, visionTrap.p4.x}), std::max({visionTrap.p1.y, visionTrap.p2.y, visionTrap.p3.y, visionTrap.p4.y})};
+    minCellIdx = WorldToMap(minPos, gameContext->cellWidth, gameContext->cellHeight);
+    maxCellIdx = WorldToMap(maxPos, gameContext->cellWidth, gameContext->cellHeight);
+    minCellIdx = {std::max(minCellIdx.x - 1, 0), std::max(minCellIdx.y - 1, 0)};
+    maxCellIdx = {std::min(maxCellIdx.x + 1, gameContext->mapGrid.width - 1), std::min(maxCellIdx.y + 1, gameContext->mapGrid.height - 1)};
+}
+
+bool IsViewshedStale(const GameContext *gameContext, const Unit &unitComp, const IsoscelesTrapezoid &visionTrap, const Viewshed &viewshed)
+{
+    if (!viewshed.valid || !(viewshed.observerCellIdx == unitComp.cellIdx) || viewshed.facingAngle != visionTrap.facingAngle)
+    {
+        return true;
+    }
+
+    // Every ray runs between two cells of the box, so only height changes inside it matter
+    Vector2i maxCellIdx = {viewshed.minCellIdx.x + viewshed.width - 1, viewshed.minCellIdx.y + viewshed.height - 1};
+    return gameContext->mapGrid.HasChangedInRect(viewshed.minCellIdx, maxCellIdx, viewshed.worldVersion);
+}
+
+// Elevation-aware shadowcasting. Each quadrant around the observer is swept row by row outwards (row = Chebyshev
+// distance); every cell keeps the horizon, the steepest slope any cell between it and the observer needs a sight line
+// to clear. A cell's horizon is interpolated from the two cells of the previous row its sight line passes between,
+// so the whole box is covered in one pass instead of one ray per cell. Slopes are measured per row rather than per
+// world unit, which scales every slope on one sight line alike and so keeps comparisons along it exact. A cell is
+// seen when the slope to its top clears its horizon; like the ray test, heights come from the materialized totals
+// and cells off the map count as height 0.
+static void CastViewshedQuadrants(const GameContext *gameContext, const Vector2i &observerCellIdx, const std::vector<uint8_t> &inCone, Viewshed &viewshed)
+{
+    struct Quadrant
+    {
+        Vector2i rowDir;
+        Vector2i colDir;
+    };
+    const Quadrant quadrants[4] = {{{0, -1}, {1, 0}}, {{0, 1}, {1, 0}}, {{1, 0}, {0, 1}}, {{-1, 0}, {0, 1}}};
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    Vector2i minCellIdx = viewshed.minCellIdx;
+    Vector2i maxCellIdx = {viewshed.minCellIdx.x + viewshed.width - 1, viewshed.minCellIdx.y + viewshed.height - 1};
+    float observerHeight = static_cast<float>(mapGrid.totalHeights[mapGrid.CellToIndex(observerCellIdx)]);
+
+    auto markVisible = [&](const Vector2i &cellIdx)
+    {
+        int bit = (cellIdx.y - minCellIdx.y) * viewshed.width + (cellIdx.x - minCellIdx.x);
+        if (inCone[bit] && mapGrid.InBounds(cellIdx))
+        {
+            viewshed.bits[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+    };
+    markVisible(observerCellIdx);
+
+    std::vector<float> prevHorizons;
+    std::vector<float> horizons;
+    for (const Quadrant &quadrant : quadrants)
+    {
+        // How far the box reaches from the observer along the row direction and both ways along the column direction
+        auto reach = [&](const Vector2i &dir)
+        {
+            return dir.x > 0 ? maxCellIdx.x - observerCellIdx.x : dir.x < 0 ? observerCellIdx.x - minCellIdx.x : dir.y > 0 ? maxCellIdx.y - observerCellIdx.y : observerCellIdx.y - minCellIdx.y;
+        };
+        int maxDepth = reach(quadrant.rowDir);
+        int colLow = -reach({-quadrant.colDir.x, -quadrant.colDir.y});
+        int colHigh = reach(quadrant.colDir);
+
+        // Horizons are indexed by column + maxDepth
+        prevHorizons.assign(2 * maxDepth + 1, -infinity);
+        horizons.assign(2 * maxDepth + 1, -infinity);
+        for (int depth = 1; depth <= maxDepth; depth++)
+        {
+            for (int col = std::max(-depth, colLow); col <= std::min(depth, colHigh); col++)
+            {
+                // Adjacent cells have nothing in between
+                float horizon = -infinity;
+                if (depth > 1)
+                {
+                    float crossing = col * (depth - 1) / static_cast<float>(depth);
+                    int nearCol = static_cast<int>(std::floor(crossing));
+                    float weight = crossing - nearCol;
+                    horizon = prevHorizons[nearCol + maxDepth];
+                    if (weight > 0.0f)
+                    {
+                        horizon += (prevHorizons[nearCol + 1 + maxDepth] - horizon) * weight;
+                    }
+                }
+
+                Vector2i cellIdx = {observerCellIdx.x + quadrant.rowDir.x * depth + quadrant.colDir.x * col,
+                                    observerCellIdx.y + quadrant.rowDir.y * depth + quadrant.colDir.y * col};
+                float cellHeight = mapGrid.InBounds(cellIdx) ? static_cast<float>(mapGrid.totalHeights[mapGrid.CellToIndex(cellIdx)]) : 0.0f;
+                float rise = cellHeight - observerHeight;
+                if (rise / depth >= horizon)
+                {
+                    markVisible(cellIdx);
+                }
+
+                // Sight lines crossing this cell must clear its top at both its near and far edge
+                horizons[col + maxDepth] = std::max(horizon, std::max(rise / (depth - 0.5f), rise / (depth + 0.5f)));
+            }
+            std::swap(prevHorizons, horizons);
+        }
+    }
+}
+
+void ComputeViewshed(const GameContext *gameContext, const Unit &unitComp, const IsoscelesTrapezoid &visionTrap, Viewshed &viewshed)
+{
+    Vector2i minCellIdx, maxCellIdx;
+    GetVisionBounds(gameContext, visionTrap, minCellIdx, maxCellIdx);
+    // The sweep starts at the observer, so the box must contain it
+    minCellIdx = {std::min(minCellIdx.x, unitComp.cellIdx.x), std::min(minCellIdx.y, unitComp.cellIdx.y)};
+    maxCellIdx = {std::max(maxCellIdx.x, unitComp.cellIdx.x), std::max(maxCellIdx.y, unitComp.cellIdx.y)};
+
+    viewshed.minCellIdx = minCellIdx;
+    viewshed.width = maxCellIdx.x - minCellIdx.x + 1;
+    viewshed.height = maxCellIdx.y - minCellIdx.y + 1;
+    viewshed.bits.assign((viewshed.width * viewshed.height + 63) / 64, 0);
+    viewshed.valid = true;
+    viewshed.worldVersion = gameContext->mapGrid.worldVersion;
+    viewshed.observerCellIdx = unitComp.cellIdx;
+    viewshed.facingAngle = visionTrap.facingAngle;
+
+    // Scanline fill of the trapezoid clips the sweep to the vision cone
+    std::vector<uint8_t> inCone(viewshed.width * viewshed.height, 0);
+    Vector2 vertices[4] = {visionTrap.p1, visionTrap.p2, visionTrap.p3, visionTrap.p4};
+    RasterizeConvexPolygon(vertices, 4, gameContext->cellWidth, gameContext->cellHeight, [&](int y, int spanMinX, int spanMaxX)
+                           {
+        if (y < minCellIdx.y || y > maxCellIdx.y)
+        {
+            return;
+        }
+        for (int x = std::max(spanMinX, minCellIdx.x); x <= std::min(spanMaxX, maxCellIdx.x); x++)
+        {
+            inCone[(y - minCellIdx.y) * viewshed.width + (x - minCellIdx.x)] = 1;
+        } });
+
+    CastViewshedQuadrants(gameContext, unitComp.cellIdx, inCone, viewshed);
+}
+
+// Adds (delta = 1) or removes (delta = -1) the viewshed's cells from its team's observer counts
+static void ApplyViewshedToTeamVision(GameContext *gameContext, const Teams &team, const Viewshed &viewshed, const int &delta)
+{
+    MapGrid &mapGrid = gameContext->mapGrid;
+    std::vector<uint16_t> &observerCounts = mapGrid.teamObserverCounts[static_cast<int>(team)];
+    for (size_t word = 0; word < viewshed.bits.size(); word++)
+    {
+        uint64_t bits = viewshed.bits[word];
+        for (int bitInWord = 0; bits != 0; bitInWord++, bits >>= 1)
+        {
+            if (!(bits & 1))
+            {
+                continue;
+            }
+            int bit = static_cast<int>(word * 64) + bitInWord;
+            Vector2i cellIdx = {viewshed.minCellIdx.x + bit % viewshed.width, viewshed.minCellIdx.y + bit / viewshed.width};
+            observerCounts[mapGrid.CellToIndex(cellIdx)] += delta;
+        }
+    }
+}
+
+// Recomputes the stale viewsheds among the given units. Observers are independent, so their viewsheds are computed
+// in parallel into scratch copies without touching the registry or the observer grids; the results are then swapped
+// into the team observer grids in one serial pass. Returns the number of recomputed viewsheds.
+int UpdateViewsheds(GameContext *gameContext, const std::vector<entt::entity> &unitEntities)
+{
+    struct PendingViewshed
+    {
+        const Unit *unitComp;
+        const IsoscelesTrapezoid *visionTrap;
+        Viewshed *viewshed;
+        Viewshed computed;
+    };
+
+    std::vector<PendingViewshed> pending;
+    for (const entt::entity &unitEntity : unitEntities)
+    {
+        const Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+        const IsoscelesTrapezoid &visionTrap = gameContext->registry.get<IsoscelesTrapezoid>(unitEntity);
+        Viewshed &viewshed = gameContext->registry.get<Viewshed>(unitEntity);
+        if (IsViewshedStale(gameContext, unitComp, visionTrap, viewshed))
+        {
+            pending.push_back({&unitComp, &visionTrap, &viewshed, Viewshed()});
+        }
+    }
+
+    const GameContext *readOnlyContext = gameContext;
+    gameContext->threadPool.ParallelFor(static_cast<int>(pending.size()), 1, [&](int begin, int end)
+                                        {
+        for (int i = begin; i < end; i++)
+        {
+            ComputeViewshed(readOnlyContext, *pending[i].unitComp, *pending[i].visionTrap, pending[i].computed);
+        } });
+
+    for (PendingViewshed &entry : pending)
+    {
+        ReleaseViewshed(gameContext, *entry.unitComp, *entry.viewshed);
+        *entry.viewshed = std::move(entry.computed);
+        ApplyViewshedToTeamVision(gameContext, entry.unitComp->team, *entry.viewshed, 1);
+    }
+    return static_cast<int>(pending.size());
+}
+
+// Takes the viewshed out of its team's observer counts, e.g. before the unit is destroyed
+void ReleaseViewshed(GameContext *gameContext, const Unit &unitComp, Viewshed &viewshed)
+{
+    if (viewshed.valid)
+    {
+        ApplyViewshedToTeamVision(gameContext, unitComp.team, viewshed, -1);
+        viewshed.valid = false;
+    }
+}
+
+bool IsCellVisibleToTeam(const GameContext *gameContext, const Teams &team, const Vector2i &cellIdx)
+{
+    const MapGrid &mapGrid = gameContext->mapGrid;
+    return mapGrid.InBounds(cellIdx) && mapGrid.teamObserverCounts[static_cast<int>(team)][mapGrid.CellToIndex(cellIdx)] > 0;
+}
+
+// Units of my own team are always visible; others only while they stand in a cell my team can see
+bool IsUnitVisibleToMyTeam(const GameContext *gameContext, const entt::entity &unitEntity)
+{
+    const Unit &unitComp = gameContext->registry.get<Unit>(unitEntity);
+    return unitComp.team == gameContext->myPlayer.team || IsCellVisibleToTeam(gameContext, gameContext->myPlayer.team, unitComp.cellIdx);
+}
\ No newline at end of file